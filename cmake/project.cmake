@@ -122,6 +122,7 @@ function(create_target target)
     ${root}/src/bank_util.cc
     ${root}/src/bank.cc
     ${root}/src/wav_recording.cc
+    ${root}/src/octave_sidecar_builder.cc
     # Printf:
     ${root}/lib/printf/printf.c
     # FatFS:
@@ -0,0 +1,304 @@
+#pragma once
+#include "circular_buffer.hh"
+#include "format_convert.hh"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace SamplerKit
+{
+
+// IMA ADPCM in fixed-size blocks that each decode on their own.
+//
+// A block holds BlockFrames frames. Each channel of a block is a 4-byte header (the first sample as 16-bit,
+// and the step index to decode the rest with) followed by the other 63 samples as 4-bit codes, two per byte,
+// low nibble first. A stereo block is the left channel followed by the right.
+namespace Adpcm
+{
+constexpr uint32_t BlockFrames = 64;
+constexpr uint32_t HeaderBytes = 4;
+constexpr uint32_t ChannelBytes = HeaderBytes + BlockFrames / 2;
+
+constexpr uint32_t block_bytes(uint32_t channels) { return ChannelBytes * channels; }
+
+// Bytes a block would take as 16-bit samples
+constexpr uint32_t decoded_block_bytes(uint32_t channels) { return BlockFrames * 2 * channels; }
+
+// Bytes of 16-bit samples that mem_bytes of blocks hold
+constexpr uint32_t decoded_size(uint32_t mem_bytes, uint32_t channels) {
+	return mem_bytes / block_bytes(channels) * decoded_block_bytes(channels);
+}
+
+inline constexpr int16_t StepTable[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
+	34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143,
+	157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658,
+	724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024,
+	3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+inline constexpr int8_t IndexTable[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+
+constexpr int32_t MaxIndex = 88;
+
+// Applies one code to the predictor and step index. The encoder tracks the decoder with this, so they agree exactly
+inline void update(uint8_t code, int32_t &pred, int32_t &index) {
+	int32_t step = StepTable[index];
+	int32_t diff = step >> 3;
+	if (code & 4)
+		diff += step;
+	if (code & 2)
+		diff += step >> 1;
+	if (code & 1)
+		diff += step >> 2;
+	pred = std::clamp<int32_t>((code & 8) ? pred - diff : pred + diff, -32768, 32767);
+	index = std::clamp<int32_t>(index + IndexTable[code], 0, MaxIndex);
+}
+
+inline uint8_t encode_sample(int32_t sample, int32_t &pred, int32_t &index) {
+	int32_t step = StepTable[index];
+	int32_t diff = sample - pred;
+	uint8_t code = 0;
+	if (diff < 0) {
+		code = 8;
+		diff = -diff;
+	}
+	if (diff >= step) {
+		code |= 4;
+		diff -= step;
+	}
+	step >>= 1;
+	if (diff >= step) {
+		code |= 2;
+		diff -= step;
+	}
+	step >>= 1;
+	if (diff >= step)
+		code |= 1;
+	update(code, pred, index);
+	return code;
+}
+
+// Encodes BlockFrames samples, every stride'th one from in, to one channel of a block at dst.
+// The step index starts where the largest of the first few sample-to-sample changes can be coded,
+// since there is no previous block to carry it over from.
+inline void encode(const int16_t *in, uint32_t stride, uint8_t *dst) {
+	int32_t largest = 0;
+	for (uint32_t i = 1; i < 4; i++)
+		largest = std::max(largest, std::abs(in[i * stride] - in[(i - 1) * stride]));
+	int32_t index = 0;
+	while (index < MaxIndex && StepTable[index] * 15 / 8 < largest)
+		index++;
+
+	int32_t pred = in[0];
+	int16_t first = in[0];
+	std::memcpy(dst, &first, 2);
+	dst[2] = (uint8_t)index;
+	dst[3] = 0;
+
+	uint8_t *codes = dst + HeaderBytes;
+	for (uint32_t i = 1; i < BlockFrames; i += 2) {
+		uint8_t lo = encode_sample(in[i * stride], pred, index);
+		uint8_t hi = (i + 1 < BlockFrames) ? encode_sample(in[(i + 1) * stride], pred, index) : 0;
+		*codes++ = lo | (hi << 4);
+	}
+}
+
+// Decodes one channel of a block at src to BlockFrames samples, written to every stride'th element of out
+inline void decode(const uint8_t *src, int16_t *out, uint32_t stride) {
+	int16_t first;
+	std::memcpy(&first, src, 2);
+	int32_t pred = first;
+	// Clamped, because a block that was never written holds whatever was in memory
+	int32_t index = std::min<int32_t>(src[2], MaxIndex);
+	out[0] = first;
+
+	const uint8_t *codes = src + HeaderBytes;
+	for (uint32_t i = 1; i < BlockFrames; i += 2) {
+		uint8_t c = *codes++;
+		update(c & 0x0F, pred, index);
+		out[i * stride] = (int16_t)pred;
+		if (i + 1 < BlockFrames) {
+			update(c >> 4, pred, index);
+			out[(i + 1) * stride] = (int16_t)pred;
+		}
+	}
+}
+} // namespace Adpcm
+
+// Compressed storage for one play buffer (PlayFormat::Adpcm).
+//
+// The CircularBuffer runs in a 16-bit address space: in, out, max and size are what they would be if it
+// held 16-bit samples, so the Cache maps file positions to it the same way as PlayFormat::S16. Block n
+// of that space is stored at min + n * Adpcm::block_bytes(). The size is a whole number of blocks, so
+// no block straddles the wrap.
+//
+// The loader encodes a block once all of its frames are written, so each block is encoded once from the
+// converted PCM, and a block the audio ISR may be playing is never written again. The frames of a partly
+// written block wait in a staging buffer until the next write completes the block, or flush() encodes it at
+// the end of the file. The resampler reads through frame(), which decodes the whole block holding the frame
+// whenever it's not the last block decoded. Frames can be read in any order, so reverse playback and starting
+// anywhere in the cache work the same as with 16-bit samples.
+class AdpcmStore {
+public:
+	// Sets up buf to hold channels-channel frames in mem_bytes of blocks starting at buf.min
+	void configure(CircularBuffer &buf, uint32_t mem_bytes, uint32_t channels) {
+		num_channels = channels;
+		frame_shift = channels == 2 ? 2 : 1;
+		base = buf.min;
+		buf.size = Adpcm::decoded_size(mem_bytes, channels);
+		buf.max = buf.min + buf.size;
+		buf.adpcm = this;
+		staged.block = NoBlock;
+		encodes.store(encodes.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// Audio ISR: the frame at 16-bit address addr, as num_channels samples.
+	// The block is decoded again if the loader has encoded any block since it was last decoded (for example,
+	// this one, after an underrun played it before it was written)
+	const int16_t *frame(uint32_t addr) {
+		uint32_t frame = (addr - base) >> frame_shift;
+		uint32_t block = frame / Adpcm::BlockFrames;
+		uint32_t encoded = encodes.load(std::memory_order_acquire);
+		if (block != decoded_block || encoded != decoded_encodes) {
+			decode_block(block, decoded.data());
+			decoded_block = block;
+			decoded_encodes = encoded;
+		}
+		return &decoded[(frame % Adpcm::BlockFrames) * num_channels];
+	}
+
+	// Loader: converts num_samples samples of sample_bytes each from wr_buff to 16-bit with convert, writes them
+	// at buf.in, and advances it. Writes do not have to start or end on a block.
+	// Set reverse if the buffer is being filled backwards, so each write ends where the one before it began.
+	// Returns the bytes (in the 16-bit address space) that were encoded and can be published with buf.written().
+	// That leaves out the frames of a block that the next write will complete: the end of a forward write, or
+	// the start of a reverse one.
+	uint32_t write(CircularBuffer &buf,
+				   const uint8_t *wr_buff,
+				   uint32_t num_samples,
+				   uint32_t sample_bytes,
+				   FormatConvert::Converter convert,
+				   bool reverse = false) {
+		const uint32_t num_frames = num_samples / num_channels;
+		const uint32_t in_frame_bytes = sample_bytes * num_channels;
+		uint32_t published = 0;
+
+		// The partly written block that the next write continues, staged after this write is done
+		Staging next;
+		bool joined = false;
+
+		for (uint32_t pos = 0; pos < num_frames;) {
+			uint32_t frame = (buf.in - base) >> frame_shift;
+			uint32_t block = frame / Adpcm::BlockFrames;
+			uint32_t first = frame % Adpcm::BlockFrames;
+			uint32_t count = std::min(num_frames - pos, Adpcm::BlockFrames - first);
+			const uint8_t *src = &wr_buff[pos * in_frame_bytes];
+			const bool continued = reverse ? pos == 0 : pos + count == num_frames;
+
+			if (block == staged.block && first <= staged.hi && first + count >= staged.lo) {
+				// Joins the staged frames
+				joined = true;
+				convert(src, &staged.pcm[first * num_channels], count * num_channels);
+				staged.lo = std::min(staged.lo, first);
+				staged.hi = std::max(staged.hi, first + count);
+				if ((staged.lo == 0 && staged.hi == Adpcm::BlockFrames) || !continued)
+					published += encode_staged();
+			} else if (count == Adpcm::BlockFrames || !continued) {
+				// A whole block, or the end of a part that nothing before a forward write (or after a reverse one)
+				// is coming to complete
+				Staging part;
+				stage(part, block, first, count, src, convert);
+				published += encode(part);
+			} else
+				stage(next, block, first, count, src, convert);
+
+			buf.offset_in_address(count << frame_shift, false);
+			pos += count;
+		}
+
+		// If this write did not join the frames staged before it, the buffer is being filled somewhere else now
+		// (it was restarted), so they are dropped
+		if (num_frames && !(joined && staged.block != NoBlock))
+			staged = next;
+		return published;
+	}
+
+	// Loader: encodes the staged frames, when nothing else will be written after them (the end of the file).
+	// Returns the bytes that can be published, like write()
+	uint32_t flush() { return staged.block == NoBlock ? 0 : encode_staged(); }
+
+private:
+	static constexpr uint32_t NoBlock = 0xFFFFFFFF;
+
+	// 16-bit frames [lo, hi) of one block
+	struct Staging {
+		uint32_t block = NoBlock;
+		uint32_t lo = 0;
+		uint32_t hi = 0;
+		alignas(4) std::array<int16_t, Adpcm::BlockFrames * 2> pcm;
+	};
+
+	void stage(Staging &st,
+			   uint32_t block,
+			   uint32_t first,
+			   uint32_t count,
+			   const uint8_t *src,
+			   FormatConvert::Converter convert) const {
+		st.block = block;
+		st.lo = first;
+		st.hi = first + count;
+		convert(src, &st.pcm[first * num_channels], count * num_channels);
+	}
+
+	uint8_t *block_addr(uint32_t block) const {
+		return reinterpret_cast<uint8_t *>(base + block * Adpcm::block_bytes(num_channels));
+	}
+
+	void decode_block(uint32_t block, int16_t *out) const {
+		const uint8_t *src = block_addr(block);
+		for (uint32_t c = 0; c < num_channels; c++)
+			Adpcm::decode(src + c * Adpcm::ChannelBytes, &out[c], num_channels);
+	}
+
+	// Encodes a block to memory, and returns the bytes of frames it holds. Frames outside [lo, hi) were never
+	// loaded, so they repeat the nearest loaded frame, which keeps the encoder's steps small
+	uint32_t encode(Staging &st) {
+		for (uint32_t i = 0; i < st.lo; i++)
+			std::copy_n(&st.pcm[st.lo * num_channels], num_channels, &st.pcm[i * num_channels]);
+		for (uint32_t i = st.hi; i < Adpcm::BlockFrames; i++)
+			std::copy_n(&st.pcm[(st.hi - 1) * num_channels], num_channels, &st.pcm[i * num_channels]);
+
+		uint8_t *dst = block_addr(st.block);
+		for (uint32_t c = 0; c < num_channels; c++)
+			Adpcm::encode(&st.pcm[c], num_channels, dst + c * Adpcm::ChannelBytes);
+		encodes.store(encodes.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		return (st.hi - st.lo) << frame_shift;
+	}
+
+	uint32_t encode_staged() {
+		uint32_t bytes = encode(staged);
+		staged.block = NoBlock;
+		return bytes;
+	}
+
+	uint32_t base = 0;
+	uint32_t num_channels = 1;
+	uint32_t frame_shift = 1;
+
+	// Loader only
+	Staging staged;
+
+	// Blocks encoded so far, written by the loader. The audio ISR reads it to tell if its decoded block is stale
+	std::atomic<uint32_t> encodes = 0;
+
+	// Audio ISR only
+	uint32_t decoded_block = NoBlock;
+	uint32_t decoded_encodes = 0;
+	std::array<int16_t, Adpcm::BlockFrames * 2> decoded{};
+};
+
+} // namespace SamplerKit
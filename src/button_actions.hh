@@ -19,6 +19,10 @@ struct ButtonActionHandler {
 	bool ignore_rev_release = false;
 	bool ignore_play_release = false;
 
+	// One-shots of the Play + Bank + Rev combos, cleared when one of them is released
+	bool stats_combo_done = false;
+	bool save_combo_done = false;
+
 	static constexpr uint32_t short_press = AudioStreamConf::FrameRate * 0.6f;
 	static constexpr uint32_t half_sec = AudioStreamConf::FrameRate * 0.5f;
 	static constexpr uint32_t one_sec = AudioStreamConf::FrameRate;
@@ -111,17 +115,24 @@ struct ButtonActionHandler {
 			}
 		}
 
-		// Long hold Play + Bank + Rev to save index
-		if (!ignore_bank_release && controls.bank_button.how_long_held_pressed() > three_sec) {
-			if (!ignore_rev_release && controls.rev_button.how_long_held_pressed() > three_sec) {
-				if (!ignore_play_release && controls.play_button.how_long_held_pressed() > three_sec) {
-					flags.set(Flag::WriteIndexToSD);
-					flags.set(Flag::WriteSettingsToSD);
-					ignore_bank_release = true;
-					ignore_play_release = true;
-					ignore_rev_release = true;
-				}
+		// Long hold Play + Bank + Rev: after one second log (and reset) the streaming statistics,
+		// and after three seconds save index
+		if (all_held(one_sec)) {
+			if (!stats_combo_done) {
+				flags.set(Flag::LogStreamStats);
+				stats_combo_done = true;
+				ignore_bank_release = true;
+				ignore_play_release = true;
+				ignore_rev_release = true;
+			}
+			if (!save_combo_done && all_held(three_sec)) {
+				flags.set(Flag::WriteIndexToSD);
+				flags.set(Flag::WriteSettingsToSD);
+				save_combo_done = true;
 			}
+		} else {
+			stats_combo_done = false;
+			save_combo_done = false;
 		}
 
 		// Bank -> change bank
@@ -167,6 +178,12 @@ struct ButtonActionHandler {
 		}
 	}
 
+	bool all_held(uint32_t time) {
+		return controls.bank_button.how_long_held_pressed() > time &&
+			   controls.rev_button.how_long_held_pressed() > time &&
+			   controls.play_button.how_long_held_pressed() > time;
+	}
+
 	void process_rec_mode() {
 		if (controls.play_button.is_just_pressed()) {
 		}
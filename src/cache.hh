@@ -1,5 +1,6 @@
 #pragma once
 #include "circular_buffer.hh"
+#include "play_format.hh"
 #include <cstdint>
 
 namespace SamplerKit
@@ -11,9 +12,12 @@ struct Cache {
 	// file position address that corresponds to highest position in file that's cached
 	uint32_t high;
 
-	// size in bytes of the cache (should always equal play_buff[]->size / 2 * sampleByteSize)
+	// size in bytes of the cache (should always equal play_buff[]->size / play_bytes(format) * sampleByteSize)
 	uint32_t size;
 
+	// how the cached samples are stored in play_buff[]
+	PlayFormat format = PlayFormat::S16;
+
 	// address in play_buff[] that corresponds to cache.low
 	uint32_t map_pt;
 
@@ -28,9 +32,9 @@ struct Cache {
 		// Find out how far ahead the buffer_point is from the buffer reference
 		uint32_t p = b->distance_points(buffer_point, map_pt, b->size, 0);
 
-		// Divide that by 2 to get the number of samples
+		// Divide that by the bytes per stored sample to get the number of samples
 		// and multiply by the sampleByteSize to get the position in the cache
-		p = (p * sampleByteSize) >> 1;
+		p = (p * sampleByteSize) / play_bytes(format);
 
 		// add that to the cache reference
 		p += low;
@@ -54,14 +58,14 @@ struct Cache {
 		// Find how many samples that is
 		p = p / sampleByteSize;
 
-		// Multiply that by 2 to get the address offset in b
-		p *= 2;
+		// Multiply that by the bytes per stored sample to get the address offset in b
+		p *= play_bytes(format);
 
 		// Add the offset to the start of the buffer
 		p += map_pt;
 
 		// Shorter way to write it is this:
-		// p = buffer_start + (((cache_point - cache_start) * 2) / sampleByteSize);
+		// p = buffer_start + (((cache_point - cache_start) / sampleByteSize) * play_bytes(format));
 
 		// Wrap the circular buffer
 		while (p > b->max)
@@ -26,36 +26,69 @@
  * -----------------------------------------------------------------------------
  */
 #pragma once
+#include "format_convert.hh"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
 #include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <span>
 
 namespace SamplerKit
 {
 
+class AdpcmStore;
+
 struct CircularBuffer {
-	uint32_t in;
-	uint32_t out;
-	uint32_t min;
-	uint32_t max;
-	uint32_t size; // should always be max-min
-	bool wrapping;
+	uint32_t in = 0;
+	uint32_t out = 0;
+	uint32_t min = 0;
+	uint32_t max = 0;
+	uint32_t size = 0; // should always be max-min
+
+	// Bytes written and played since init(). These only ever increase, so in_count - out_count is the
+	// exact fill level even when in == out. The loader (main loop) publishes in_count with a release
+	// store after writing the data, and the audio ISR publishes out_count the same way after playing it.
+	std::atomic<uint32_t> in_count;
+	std::atomic<uint32_t> out_count;
+
+	// Set if the buffer holds PlayFormat::Adpcm blocks (see adpcm.hh)
+	AdpcmStore *adpcm = nullptr;
 
 	CircularBuffer() { init(); }
 	void init() {
-		wrapping = 0;
 		in = min;
 		out = min;
+		in_count.store(0, std::memory_order_relaxed);
+		out_count.store(0, std::memory_order_release);
+	}
+
+	// Bytes buffered ahead of the out ptr. More than size means the loader overwrote data not yet played,
+	// less than 0 means the audio ISR played data that was not loaded yet
+	int32_t fill() const {
+		return (int32_t)(in_count.load(std::memory_order_acquire) - out_count.load(std::memory_order_acquire));
+	}
+
+	// Loader: publish bytes that were written ahead of the out ptr
+	void written(uint32_t bytes) {
+		in_count.store(in_count.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+	}
+
+	// Audio ISR: release bytes that were played
+	void played(uint32_t bytes) {
+		out_count.store(out_count.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+	}
+
+	// Sets the fill level after the in or out ptr was moved to a new position in the cache
+	void resync_counts(uint32_t fill_bytes) {
+		out_count.store(in_count.load(std::memory_order_relaxed) - fill_bytes, std::memory_order_release);
 	}
 
 	void wait_memory_ready() {
 		// Memory::wait_until_ready();
 	}
 
-	// FIXME: For all the memory IO, we could use memcpy to save some cycles
-	//  - Is it worth it? Memory IO is not the bottleneck (SD card IO is)
-	//  - We'd need to write new under/overflow checks
-
-	// TODO: use span<int16_t>
 	uint32_t memory_read16(std::span<int16_t> rd_buff, bool decrement) {
 		return memory_read16(rd_buff.data(), rd_buff.size(), decrement);
 	}
@@ -63,173 +96,192 @@ struct CircularBuffer {
 	// Read num_samples from the out ptr, and put them in rd_buff
 	// Pad rd_buff with 0's if we underflow our CircularBuffer
 	uint32_t memory_read16(int16_t *rd_buff, uint32_t num_samples, bool decrement) {
-		uint32_t num_underflowed = 0;
-		for (uint32_t i = 0; i < num_samples; i++) {
-
-			if (out == in)
-				num_underflowed = 1;
-			else if (num_underflowed)
-				num_underflowed++;
+		uint32_t num_read = std::min(num_samples, distance(decrement) / 2);
 
-			if (num_underflowed)
-				rd_buff[i] = 0;
+		read_runs(num_read, 2, decrement, [=](uint32_t src, uint32_t pos, uint32_t count) {
+			if (!decrement)
+				std::memcpy(&rd_buff[pos], reinterpret_cast<int16_t *>(src), count * 2);
 			else {
-				wait_memory_ready();
-				rd_buff[i] = *reinterpret_cast<int16_t *>(out);
+				auto *s = reinterpret_cast<int16_t *>(src);
+				for (uint32_t i = 0; i < count; i++)
+					rd_buff[pos + i] = *s--;
 			}
+		});
 
-			offset_out_address(2, decrement);
-			out = (out & 0xFFFFFFFE);
+		uint32_t num_underflowed = num_samples - num_read;
+		if (num_underflowed) {
+			std::fill_n(&rd_buff[num_read], num_underflowed, 0);
+			offset_out_address(num_underflowed * 2, decrement);
 		}
+		out = (out & 0xFFFFFFFE);
 		return num_underflowed;
 	}
 
+	uint32_t memory_read24(std::span<uint8_t> rd_buff, bool decrement) {
+		return memory_read24(rd_buff.data(), rd_buff.size() / 3, decrement);
+	}
+
+	// Read num_samples packed 24-bit samples from the out ptr, and put them in rd_buff
+	// Pad rd_buff with 0's if we underflow our CircularBuffer
 	uint32_t memory_read24(uint8_t *rd_buff, uint32_t num_samples, bool decrement) {
-		uint32_t i;
-		uint32_t num_bytes = num_samples * 3;
+		uint32_t num_read = std::min(num_samples, distance(decrement) / 3);
 
-		for (i = 0; i < num_bytes; i++) {
-			wait_memory_ready();
-			rd_buff[i] = *reinterpret_cast<int8_t *>(out);
-			offset_out_address(1, decrement);
+		// Read as bytes: the out ptr can wrap in the middle of a sample
+		read_runs(num_read * 3, 1, decrement, [=](uint32_t src, uint32_t pos, uint32_t count) {
+			if (!decrement)
+				std::memcpy(&rd_buff[pos], reinterpret_cast<uint8_t *>(src), count);
+			else {
+				auto *s = reinterpret_cast<uint8_t *>(src);
+				for (uint32_t i = 0; i < count; i++)
+					rd_buff[pos + i] = *s--;
+			}
+		});
+
+		uint32_t num_underflowed = num_samples - num_read;
+		if (num_underflowed) {
+			std::fill_n(&rd_buff[num_read * 3], num_underflowed * 3, 0);
+			offset_out_address(num_underflowed * 3, decrement);
 		}
-		return 0; // does not check for overflow
+		return num_underflowed;
 	}
 
-	// Grab 16-bit ints and write them into b as 16-bit ints
-	// num_words should be the number of 32-bit words to read from wr_buff (bytes>>2)
-	uint32_t memory_write_16as16(uint32_t *wr_buff, uint32_t num_words, bool decrement) {
-		uint32_t i;
-		uint8_t start_polarity, end_polarity, start_wrap, end_wrap;
-
-		// detect head-crossing:
-		start_polarity = (in < out) ? 0 : 1;
-		start_wrap = wrapping;
+	// Reads num_items items of item_bytes each at the out ptr, and advances it.
+	// The read is split where the out ptr wraps, so read_run(src, pos, count) is called with
+	// at most two contiguous runs: items [pos, pos + count) come from src, src + item_bytes, ...
+	// or, if decrement is set, from src, src - item_bytes, ...
+	// Does not check for underflow: the caller limits num_items to what is buffered.
+	template<typename F>
+	void read_runs(uint32_t num_items, uint32_t item_bytes, bool decrement, F &&read_run) {
+		for (uint32_t pos = 0; pos < num_items;) {
+			// Items that can be read before the one that makes the out ptr wrap (inclusive)
+			uint32_t room = decrement ? (out - min) / item_bytes + 1 : (max - out + item_bytes - 1) / item_bytes;
+			uint32_t count = std::min(num_items - pos, std::max<uint32_t>(room, 1));
 
-		for (i = 0; i < num_words; i++) {
 			wait_memory_ready();
-			// *((uint32_t *)in) = wr_buff[i];
-			*reinterpret_cast<uint32_t *>(in) = wr_buff[i];
-			offset_in_address(4, decrement);
+			read_run(out, pos, count);
+			offset_out_address(count * item_bytes, decrement);
+			pos += count;
 		}
+	}
 
-		end_polarity = (in < out) ? 0 : 1;
-		end_wrap = wrapping; // 0 or 1
-
-		// start_polarity + end_polarity  is (0/2 if no change, 1 if change)
-		// start_wrap + end_wrap is (0/2 if no change, 1 if change)
-		// Thus the sum of all four is even unless just polarity or just wrap changes (but not both)
-
-		if ((end_wrap + start_wrap + start_polarity + end_polarity) & 0b01) // if (sum is odd)
-			return 1; // warning: in pointer and out pointer crossed
-		else
-			return 0; // pointers did not cross
+	// Grab 16-bit ints and write them into b as 16-bit ints
+	// num_words should be the number of 32-bit words to read from wr_buff (bytes>>2)
+	uint32_t memory_write_16as16(uint32_t *wr_buff, uint32_t num_words, bool decrement) {
+		return write_runs(num_words, 4, decrement, [=](uint32_t dst, uint32_t pos, uint32_t count) {
+			if (!decrement)
+				std::memcpy(reinterpret_cast<uint32_t *>(dst), &wr_buff[pos], count * 4);
+			else {
+				auto *d = reinterpret_cast<uint32_t *>(dst);
+				for (uint32_t i = 0; i < count; i++)
+					*d-- = wr_buff[pos + i];
+			}
+		});
 	}
 
 	// Convert 24-bit words from wr_buff into 16-bit words, and write to the in ptr
 	uint32_t memory_write_24as16(uint8_t *wr_buff, uint32_t num_bytes, bool decrement) {
-		uint32_t i;
-		uint8_t start_polarity, end_polarity, start_wrap, end_wrap;
-
-		start_polarity = (in < out) ? 0 : 1;
-		start_wrap = wrapping;
-
-		for (i = 0; i < num_bytes; i += 3) // must be a multiple of 3!
-		{
-			wait_memory_ready();
-			auto s = (int16_t)(wr_buff[i + 2] << 8 | wr_buff[i + 1]);
-			*reinterpret_cast<int16_t *>(in) = s;
-			offset_in_address(2, decrement);
-		}
-
-		end_polarity = (in < out) ? 0 : 1;
-		end_wrap = wrapping; // 0 or 1
-
-		if ((end_wrap + start_wrap + start_polarity + end_polarity) & 0b01)
-			return 1; // warning: in pointer and out pointer crossed
-		else
-			return 0; // pointers did not cross
+		// must be a multiple of 3!
+		return memory_write_as16(wr_buff, num_bytes / 3, 3, FormatConvert::s24, decrement);
 	}
 
 	// Grab 32-bit words and write them into b as 16-bit values
 	uint32_t memory_write_32ias16(uint8_t *wr_buff, uint32_t num_bytes, bool decrement) {
-		uint32_t i;
-		uint8_t start_polarity, end_polarity, start_wrap, end_wrap;
-
-		start_polarity = (in < out) ? 0 : 1;
-		start_wrap = wrapping;
-
-		for (i = 0; i < num_bytes; i += 4) {
-			wait_memory_ready();
-			auto s = (int16_t)(wr_buff[i + 3] << 8 | wr_buff[i + 2]);
-			*reinterpret_cast<int16_t *>(in) = s;
-			offset_in_address(2, decrement);
-		}
-
-		end_polarity = (in < out) ? 0 : 1;
-		end_wrap = wrapping; // 0 or 1
-
-		if ((end_wrap + start_wrap + start_polarity + end_polarity) & 0b01)
-			return 1; // warning: in pointer and out pointer crossed
-		else
-			return 0; // pointers did not cross
+		return memory_write_as16(wr_buff, num_bytes / 4, 4, FormatConvert::s32, decrement);
 	}
 
 	// Grab 32-bit floats and write them into b as 16-bit values
 	uint32_t memory_write_32fas16(float *wr_buff, uint32_t num_floats, bool decrement) {
-		uint32_t i;
-		uint8_t start_polarity, end_polarity, start_wrap, end_wrap;
-
-		start_polarity = (in < out) ? 0 : 1;
-		start_wrap = wrapping;
-
-		for (i = 0; i < num_floats; i++) {
-			wait_memory_ready();
-			int16_t s;
-			if (wr_buff[i] >= 1.f)
-				s = 32767;
-			else if (wr_buff[i] <= -1.F)
-				s = -32768;
-			else
-				s = (int16_t)(wr_buff[i] * 32767.f);
-
-			*reinterpret_cast<int16_t *>(in) = s;
+		return memory_write_as16(reinterpret_cast<uint8_t *>(wr_buff), num_floats, 4, FormatConvert::f32, decrement);
+	}
 
-			offset_in_address(2, decrement);
-		}
+	// Grab 8-bit ints from wr_buff and write them into b as 16-bit ints
+	uint32_t memory_write_8as16(uint8_t *wr_buff, uint32_t num_bytes, bool decrement) {
+		return memory_write_as16(wr_buff, num_bytes, 1, FormatConvert::u8, decrement);
+	}
 
-		end_polarity = (in < out) ? 0 : 1;
-		end_wrap = wrapping; // 0 or 1
+	// Convert num_samples samples of sample_bytes each from wr_buff into 16-bit values, and write to the in ptr
+	uint32_t memory_write_as16(const uint8_t *wr_buff,
+							   uint32_t num_samples,
+							   uint32_t sample_bytes,
+							   FormatConvert::Converter convert,
+							   bool decrement) {
+		return memory_write_as(wr_buff, num_samples, sample_bytes, convert, 2, decrement);
+	}
 
-		if ((end_wrap + start_wrap + start_polarity + end_polarity) & 0b01)
-			return 1; // warning: in pointer and out pointer crossed
-		else
-			return 0; // pointers did not cross
+	// Convert num_samples samples of sample_bytes each from wr_buff with convert, which writes out_bytes
+	// per sample, and write them to the in ptr
+	template<typename Out>
+	uint32_t memory_write_as(const uint8_t *wr_buff,
+							 uint32_t num_samples,
+							 uint32_t sample_bytes,
+							 void (*convert)(const uint8_t *, Out *, uint32_t),
+							 uint32_t out_bytes,
+							 bool decrement) {
+		return write_runs(num_samples, out_bytes, decrement, [=](uint32_t dst, uint32_t pos, uint32_t count) {
+			if (!decrement) {
+				convert(&wr_buff[pos * sample_bytes], reinterpret_cast<Out *>(dst), count);
+				return;
+			}
+			// Convert to a temporary buffer, and write it backwards
+			constexpr uint32_t TmpSamples = 64;
+			alignas(4) uint8_t tmp[TmpSamples * 4];
+			while (count) {
+				uint32_t n = std::min(count, TmpSamples);
+				convert(&wr_buff[pos * sample_bytes], reinterpret_cast<Out *>(tmp), n);
+				for (uint32_t i = 0; i < n; i++) {
+					std::memcpy(reinterpret_cast<uint8_t *>(dst), &tmp[i * out_bytes], out_bytes);
+					dst -= out_bytes;
+				}
+				pos += n;
+				count -= n;
+			}
+		});
 	}
 
-	// Grab 8-bit ints from wr_buff and write them into b as 16-bit ints
-	uint32_t memory_write_8as16(uint8_t *wr_buff, uint32_t num_bytes, bool decrement) {
-		uint32_t i;
-		uint8_t start_polarity, end_polarity, start_wrap, end_wrap;
+	// Writes num_items items of item_bytes each at the in ptr, and advances it.
+	// The write is split where the in ptr wraps, so write_run(dst, pos, count) is called with
+	// at most two contiguous runs: items [pos, pos + count) go to dst, dst + item_bytes, ...
+	// or, if decrement is set, to dst, dst - item_bytes, ...
+	// Returns 1 if the write ran over data not yet played: more than the free space (size - fill()) was written.
+	// (Only writes that were published with written() count toward the fill level)
+	template<typename F>
+	uint32_t write_runs(uint32_t num_items, uint32_t item_bytes, bool decrement, F &&write_run) {
+		const bool crossed = (int64_t)fill() + num_items * item_bytes > size;
+
+		// An item must not straddle max (see whole_frame_bytes())
+		assert(size % item_bytes == 0 && (in - min) % item_bytes == 0);
 
-		// setup to detect head-crossing:
-		start_polarity = (in < out) ? 0 : 1;
-		start_wrap = wrapping;
+		for (uint32_t pos = 0; pos < num_items;) {
+			// Items that can be written before the one that makes the in ptr wrap (inclusive)
+			uint32_t room = decrement ? (in - min) / item_bytes + 1 : (max - in + item_bytes - 1) / item_bytes;
+			uint32_t count = std::min(num_items - pos, std::max<uint32_t>(room, 1));
 
-		for (i = 0; i < num_bytes; i++) {
 			wait_memory_ready();
-			auto s = ((int16_t)(wr_buff[i]) - 128) * 256;
-			*reinterpret_cast<int16_t *>(in) = s;
-			offset_in_address(2, decrement);
+			write_run(in, pos, count);
+			offset_in_address(count * item_bytes, decrement);
+			pos += count;
 		}
 
-		end_polarity = (in < out) ? 0 : 1;
-		end_wrap = wrapping; // 0 or 1
+		return crossed ? 1 : 0;
+	}
+
+	// Address of the in ptr if bytes can be written there in one run without wrapping, and the in ptr is
+	// aligned to align bytes. Otherwise 0
+	uint32_t contiguous_in(uint32_t bytes, uint32_t align) const {
+		return ((in & (align - 1)) == 0 && (max - in) >= bytes) ? in : 0;
+	}
+
+	// Address bytes before the in ptr if bytes can be written there in one run without wrapping, and that address
+	// is aligned to align bytes. Otherwise 0. (Reverse reads are written in file order just before the in ptr)
+	uint32_t contiguous_before_in(uint32_t bytes, uint32_t align) const {
+		return ((in - min) >= bytes && ((in - bytes) & (align - 1)) == 0) ? in - bytes : 0;
+	}
 
-		if ((end_wrap + start_wrap + start_polarity + end_polarity) & 0b01) // if (sum is odd)
-			return 1; // warning: in pointer and out pointer crossed
-		else
-			return 0; // pointers did not cross
+	// Bytes that can be written just before the in ptr in one run, without wrapping or overwriting data not yet
+	// played (see contiguous_before_in())
+	uint32_t room_before_in() const {
+		const uint32_t free = size - (uint32_t)std::clamp<int32_t>(fill(), 0, (int32_t)size);
+		return std::min(in - min, free);
 	}
 
 	uint32_t memory_write16(int16_t *wr_buff, uint32_t num_samples, bool decrement) {
@@ -250,52 +302,37 @@ struct CircularBuffer {
 		return heads_crossed;
 	}
 
-	uint8_t offset_in_address(uint32_t amt, bool subtract) {
+	// Moves the in ptr by amt bytes, wrapping at min and max. The in and out ptrs are moved from different
+	// contexts (e.g. the loader and the audio ISR), so the two moves share no state: whether the ptrs have
+	// crossed is told from in_count and out_count.
+	void offset_in_address(uint32_t amt, bool subtract) {
 		if (!subtract) {
 			if ((max - in) <= amt) // same as "if ((in + amt) >= max)" but doing the math this way avoids
 								   // overflow in case max == 0xFFFFFFFF
-			{
 				in -= size - amt;
-				if (wrapping)
-					return 1; // warning: already wrapped, and wrapped again!
-				wrapping = 1;
-			} else
+			else
 				in += amt;
 		} else {
 			if ((in - min) < amt) // same as "if (in - amt) < min" but avoids using negative numbers in case amt > in
-			{
 				in += size - amt;
-				if (!wrapping)
-					return 1; // warning: already unwrapped!
-				wrapping = 0;
-			} else
+			else
 				in -= amt;
 		}
-		return 0;
 	}
 
-	uint8_t offset_out_address(uint32_t amt, bool subtract) {
+	void offset_out_address(uint32_t amt, bool subtract) {
 		if (!subtract) {
 			if ((max - out) <= amt) // same as "if (out + amt) > max" but doing the math this way avoids
 									// overflow in case max == 0xFFFFFFFF
-			{
 				out -= size - amt;
-				if (!wrapping)
-					return 1; // warning: already unwrapped!
-				wrapping = 0;
-			} else
+			else
 				out += amt;
 		} else {
 			if ((out - min) < amt) // same as "if (out - amt) < min" but avoids using negative numbers in case amt > out
-			{
 				out += size - amt;
-				if (wrapping)
-					return 1; // warning: already wrapped, and wrapped again!
-				wrapping = 1;
-			} else
+			else
 				out -= amt;
 		}
-		return 0;
 	}
 
 	static uint32_t distance_points(uint32_t leader, uint32_t follower, uint32_t size, bool reverse) {
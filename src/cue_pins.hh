@@ -0,0 +1,114 @@
+#pragma once
+#include "circular_buffer.hh"
+#include "elements.hh"
+#include "play_format.hh"
+#include "sampler_calcs.hh"
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace SamplerKit
+{
+
+// Pinned copies of the start of each cue region of a slot's sample, so playback can jump between cues
+// without PREBUFFERING. Pin 0 is the start of the sample, and pins 1-4 are cues 1-4.
+//
+// The pins are stored in the slot's cache format, in an area reserved at the end of the slot's memory past
+// the play_buff window. The loader fills them a block at a time when it's idle, and start_playing() copies
+// one into play_buff when the position it starts from is not in the streaming cache.
+class CuePins {
+public:
+	static constexpr uint32_t NumPins = 5;
+
+	// File bytes pinned at each cue. Stored samples are never larger than in the file, so the reserved
+	// area for a pin is the same size in any format
+	static constexpr uint32_t PinFileBytes = PREFETCH_SIZE;
+	static constexpr uint32_t ReservedBytes = NumPins * PinFileBytes;
+
+	static constexpr uint32_t NoPin = UINT32_MAX;
+
+	struct Pin {
+		uint32_t pos = NoPin;	 // file position of the start of the pin
+		uint32_t file_bytes = 0; // file bytes pinned so far
+		uint32_t bytes = 0;		 // bytes stored
+	};
+
+	// File position pin i starts at, or NoPin if cue i is not a valid start point
+	static uint32_t pin_pos(const Sample &sample, unsigned i) {
+		if (i == 0)
+			return align_addr(sample.inst_start, sample.blockAlign);
+		if (i > sample.num_cues)
+			return NoPin;
+		uint32_t cue = cue_pos(i, &sample);
+		return (cue >= sample.inst_start && cue < sample.inst_end) ? cue : NoPin;
+	}
+
+	// File bytes to pin starting at pos: PinFileBytes, or up to the end of the sample
+	static uint32_t pin_size(const Sample &sample, uint32_t pos) {
+		return align_addr(std::min(PinFileBytes, sample.inst_end - pos), sample.blockAlign);
+	}
+
+	// Sets the address of the reserved area, and empties the pins
+	void set_base(uint32_t addr) {
+		base = addr;
+		clear();
+	}
+
+	void clear() { pins = {}; }
+
+	const Pin &operator[](unsigned i) const { return pins[i]; }
+
+	// Format the pins are stored in
+	PlayFormat format() const { return pin_format; }
+
+	// Starts pin i over at file position pos, stored in format. All pins are emptied if the format changed
+	void start(unsigned i, uint32_t pos, PlayFormat new_format) {
+		if (new_format != pin_format) {
+			clear();
+			pin_format = new_format;
+		}
+		pins[i] = {pos, 0, 0};
+	}
+
+	// Sets buf up to write the next block of pin i with the usual CircularBuffer writes
+	void attach(unsigned i, CircularBuffer &buf) const {
+		buf.min = base + i * PinFileBytes;
+		buf.max = buf.min + PinFileBytes;
+		buf.size = PinFileBytes;
+		buf.init();
+		buf.in = buf.min + pins[i].bytes;
+	}
+
+	// Records a block written to pin i
+	void appended(unsigned i, uint32_t file_bytes, uint32_t bytes) {
+		pins[i].file_bytes += file_bytes;
+		pins[i].bytes += bytes;
+	}
+
+	// The pin starting at file position pos and stored in format, or nullptr if none
+	const Pin *find(uint32_t pos, PlayFormat fmt) const {
+		if (fmt != pin_format)
+			return nullptr;
+		for (auto &pin : pins) {
+			if (pin.pos == pos && pin.file_bytes)
+				return &pin;
+		}
+		return nullptr;
+	}
+
+	// Copies a pin to buf's in ptr and publishes it to the audio ISR
+	void restore(const Pin &pin, CircularBuffer &buf) const {
+		auto src = reinterpret_cast<const uint8_t *>(base + (&pin - pins.data()) * PinFileBytes);
+		buf.write_runs(pin.bytes, 1, false, [=](uint32_t dst, uint32_t pos, uint32_t count) {
+			std::memcpy(reinterpret_cast<uint8_t *>(dst), &src[pos], count);
+		});
+		buf.written(pin.bytes);
+	}
+
+private:
+	uint32_t base = 0;
+	PlayFormat pin_format = PlayFormat::S16;
+	std::array<Pin, NumPins> pins{};
+};
+
+} // namespace SamplerKit
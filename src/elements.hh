@@ -48,6 +48,14 @@ constexpr inline uint32_t BASE_BUFFER_THRESHOLD = 64 * 3;
 // It also should be a multiple of 512, since the SD Card is arranged by 512 byte sectors
 // 9216 = 512 * 18 = 24 * 384
 constexpr inline uint32_t READ_BLOCK_SIZE = 9216;
+// Amount of each idle slot's sample the loader prefetches (in file bytes), so it can start playing
+// while the loader catches up. 18kB is about 100ms of 16-bit stereo at 48kHz
+constexpr inline uint32_t PREFETCH_SIZE = READ_BLOCK_SIZE * 2;
+// A prefetch starts this far before the start position, so that ADC noise on the Start knob and CV doesn't
+// restart it. (A multiple of all sample file block sizes, like READ_BLOCK_SIZE)
+constexpr inline uint32_t PREFETCH_MARGIN = READ_BLOCK_SIZE / 2;
 constexpr inline float PERC_ENV_FACTOR = 40000.0f;
+// Highest resample rate we play at. This is limited by SD Card bandwidth
+// (the loader pre-buffers proportionally to the rate), not by the resampler.
 constexpr inline float MAX_RS = 20.f;
 } // namespace SamplerKit
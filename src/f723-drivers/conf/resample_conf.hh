@@ -0,0 +1,16 @@
+#pragma once
+
+namespace SamplerKit
+{
+struct ResampleConf {
+	// Cortex-M7: use the integer Hermite kernel (dual 16-bit MACs on the packed play buffer data)
+	static constexpr bool IntegerKernel = true;
+	static constexpr bool VectorKernel = false;
+
+	// Unity pitch with a rational rate (44.1k on 48k): integer kernel with exact phase steps and tabled weights
+	static constexpr bool RationalKernel = true;
+
+	// Taps of the windowed-sinc kernel used in High resample quality (see tests/bench/resample_bench.cc for costs)
+	static constexpr unsigned SincTaps = 16;
+};
+} // namespace SamplerKit
@@ -19,6 +19,10 @@ public:
 
 	enum class Status { NotInit, NoCard, Mounted };
 
+	// Blocks read by the throughput test at mount, and the ms it took (0 if not tested yet)
+	static constexpr uint32_t RxTestBlocks = 256;
+	uint32_t rx_test_ms = 0;
+
 	SDCardOps(SDCardOps &other) = delete;
 	SDCardOps() = default;
 
@@ -38,15 +42,11 @@ public:
 
 		if (sd.detect_card()) {
 			_status = Status::Mounted;
-			// DEBUG: Test RX throughput
-			// static bool tested = false;
-			// if (!tested) {
-			// 	tested = true;
-			// 	uint32_t ms_per_10MB = sd.test_rx_speed(0, 10 * 2048);
-			// 	float s_per_10MB = (float)ms_per_10MB / 1000.f;
-			// 	float s_per_MB = s_per_10MB / 10.f;
-			// 	printf_("%d ms/10MB = %fMB/s\n", ms_per_10MB, 1.f / s_per_MB);
-			// }
+			// Time a read when the card is first mounted, as a starting point for sizing sample reads
+			if (!rx_speed_tested) {
+				rx_speed_tested = true;
+				rx_test_ms = sd.test_rx_speed(0, RxTestBlocks);
+			}
 			return 0;
 		} else {
 			_status = Status::NoCard;
@@ -122,4 +122,5 @@ public:
 
 private:
 	Status _status = Status::NotInit;
+	bool rx_speed_tested = false;
 };
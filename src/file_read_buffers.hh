@@ -0,0 +1,43 @@
+#pragma once
+#include "ff.h"
+#include <cstdint>
+
+namespace SamplerKit
+{
+
+// Two buffers that sample file reads alternate between, so the block read last is still intact while the
+// block before it is being copied into a play buffer by DMA (see PlayBuffDma).
+//
+// Reads are still blocking: f_read() waits for the SD card's multi-sector DMA transfer, and neither FatFs nor
+// SDCardOps has a read that returns before the data is in. So this does not take the read off the main loop, it
+// only lets the play buffer copy of one block run while the next block is read. The filled buffer is returned
+// to the caller to convert. A copy from a buffer may still be running when a later read (streaming, prefetch or
+// cue pin) comes back around to it, so read() calls release(buffer) before filling it, to finish that copy.
+template<uint32_t BlockSize>
+class FileReadBuffers {
+public:
+	struct Block {
+		FRESULT res;
+		UINT bytes_read;
+		const uint8_t *data;
+	};
+
+	// Reads bytes (at most BlockSize) from fil's file position into the next buffer, and returns when it's done
+	template<typename Release>
+	Block read(FIL *fil, uint32_t bytes, Release &&release) {
+		auto *buf = reinterpret_cast<uint8_t *>(buffers[next]);
+		next ^= 1;
+		release(static_cast<const uint8_t *>(buf));
+
+		Block block{FR_OK, 0, buf};
+		block.res = f_read(fil, buf, bytes, &block.bytes_read);
+		return block;
+	}
+
+private:
+	// Word-aligned, for the SD card's DMA
+	uint32_t buffers[2][(BlockSize >> 2) + 2];
+	unsigned next = 0;
+};
+
+} // namespace SamplerKit
@@ -63,6 +63,8 @@ enum class Flag : uint32_t {
 	WriteSettingsToSD,
 	WriteIndexToSD,
 
+	LogStreamStats,
+
 	NUM_FLAGS
 };
 
@@ -0,0 +1,204 @@
+#pragma once
+#include "packed16.hh"
+#include "play_format.hh"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Block converters from the sample file formats to the 16-bit play buffer format.
+//
+// Targets with NEON convert 8 or 16 samples per iteration. Other targets load and store whole
+// 32-bit words and pack the 16-bit results with the Packed16 helpers (DSP instructions on Cortex-M7).
+// Neither the input nor the output needs to be word-aligned.
+namespace SamplerKit::FormatConvert
+{
+
+// Converts num_samples samples from in, and writes them to out as 16-bit values
+using Converter = void (*)(const uint8_t *in, int16_t *out, uint32_t num_samples);
+
+namespace Word
+{
+inline uint32_t load(const uint8_t *p) {
+	uint32_t w;
+	std::memcpy(&w, p, 4);
+	return w;
+}
+
+inline void store(int16_t *p, uint32_t w) {
+	std::memcpy(p, &w, 4);
+}
+} // namespace Word
+
+// 16-bit: copied as is
+inline void s16(const uint8_t *in, int16_t *out, uint32_t num_samples) {
+	std::memcpy(out, in, num_samples * 2);
+}
+
+// Packed 24-bit: the upper two bytes of each sample
+inline void s24(const uint8_t *in, int16_t *out, uint32_t num_samples) {
+	uint32_t i = 0;
+
+#if defined(__ARM_NEON)
+	for (; i + 16 <= num_samples; i += 16) {
+		uint8x16x3_t bytes = vld3q_u8(&in[i * 3]);
+		uint8x16x2_t hi = {{bytes.val[1], bytes.val[2]}};
+		vst2q_u8(reinterpret_cast<uint8_t *>(&out[i]), hi);
+	}
+#endif
+
+	// Four samples are three words: [l0 m0 h0 l1] [m1 h1 l2 m2] [h2 l3 m3 h3]
+	for (; i + 4 <= num_samples; i += 4) {
+		uint32_t w0 = Word::load(&in[i * 3]);
+		uint32_t w1 = Word::load(&in[i * 3 + 4]);
+		uint32_t w2 = Word::load(&in[i * 3 + 8]);
+		Word::store(&out[i], Packed16::pack_lo(w0 >> 8, w1));
+		Word::store(&out[i + 2], Packed16::pack_lo((w1 >> 24) | (w2 << 8), w2 >> 16));
+	}
+
+	for (; i < num_samples; i++)
+		out[i] = (int16_t)(in[i * 3 + 2] << 8 | in[i * 3 + 1]);
+}
+
+// 32-bit int: the upper two bytes of each sample
+inline void s32(const uint8_t *in, int16_t *out, uint32_t num_samples) {
+	uint32_t i = 0;
+
+#if defined(__ARM_NEON)
+	for (; i + 8 <= num_samples; i += 8) {
+		int16x8x2_t halves = vld2q_s16(reinterpret_cast<const int16_t *>(&in[i * 4]));
+		vst1q_s16(&out[i], halves.val[1]);
+	}
+#endif
+
+	for (; i + 2 <= num_samples; i += 2)
+		Word::store(&out[i], Packed16::pack_hi(Word::load(&in[i * 4]), Word::load(&in[i * 4 + 4])));
+
+	for (; i < num_samples; i++)
+		out[i] = (int16_t)(in[i * 4 + 3] << 8 | in[i * 4 + 2]);
+}
+
+// 32-bit float: scaled by 32767 and truncated, -1.0 and below is -32768
+inline int16_t f32_sample(float f) {
+	return (f <= -1.f) ? -32768 : (int16_t)(std::min(f, 1.f) * 32767.f);
+}
+
+inline void f32(const uint8_t *in, int16_t *out, uint32_t num_samples) {
+	uint32_t i = 0;
+
+#if defined(__ARM_NEON)
+	const float32x4_t one = vdupq_n_f32(1.f);
+	const float32x4_t minus_one = vdupq_n_f32(-1.f);
+	const int32x4_t min16 = vdupq_n_s32(-32768);
+	for (; i + 4 <= num_samples; i += 4) {
+		float32x4_t f = vreinterpretq_f32_u8(vld1q_u8(&in[i * 4]));
+		int32x4_t s = vcvtq_s32_f32(vmulq_n_f32(vminq_f32(f, one), 32767.f));
+		s = vbslq_s32(vcleq_f32(f, minus_one), min16, s);
+		vst1_s16(&out[i], vmovn_s32(s));
+	}
+#endif
+
+	for (; i < num_samples; i++) {
+		float f;
+		std::memcpy(&f, &in[i * 4], 4);
+		out[i] = f32_sample(f);
+	}
+}
+
+// Unsigned 8-bit: offset by 128 and scaled by 256
+inline void u8(const uint8_t *in, int16_t *out, uint32_t num_samples) {
+	uint32_t i = 0;
+
+#if defined(__ARM_NEON)
+	const uint8x16_t offset = vdupq_n_u8(0x80);
+	for (; i + 16 <= num_samples; i += 16) {
+		uint8x16_t x = veorq_u8(vld1q_u8(&in[i]), offset);
+		vst1q_s16(&out[i], vreinterpretq_s16_u16(vshll_n_u8(vget_low_u8(x), 8)));
+		vst1q_s16(&out[i + 8], vreinterpretq_s16_u16(vshll_n_u8(vget_high_u8(x), 8)));
+	}
+#endif
+
+	// Flipping the top bit is the same as subtracting 128. Each byte then goes to the top of a 16-bit half
+	for (; i + 4 <= num_samples; i += 4) {
+		uint32_t x = Word::load(&in[i]) ^ 0x80808080;
+		Word::store(&out[i], ((x & 0x00FF) << 8) | ((x & 0xFF00) << 16));
+		Word::store(&out[i + 2], ((x >> 8) & 0xFF00) | (x & 0xFF000000));
+	}
+
+	for (; i < num_samples; i++)
+		out[i] = (int16_t)((in[i] ^ 0x80) << 8);
+}
+
+// Converters to the other play buffer storage formats (see play_format.hh).
+// Same as Converter, but the output is num_samples samples of 1 or 3 bytes
+using Store = void (*)(const uint8_t *in, uint8_t *out, uint32_t num_samples);
+
+// Unsigned 8-bit to signed 8-bit
+inline void s8_from_u8(const uint8_t *in, uint8_t *out, uint32_t num_samples) {
+	uint32_t i = 0;
+	for (; i + 4 <= num_samples; i += 4) {
+		uint32_t x = Word::load(&in[i]) ^ 0x80808080;
+		std::memcpy(&out[i], &x, 4);
+	}
+	for (; i < num_samples; i++)
+		out[i] = in[i] ^ 0x80;
+}
+
+// Packed 24-bit: copied as is
+inline void s24_from_s24(const uint8_t *in, uint8_t *out, uint32_t num_samples) {
+	std::memcpy(out, in, num_samples * 3);
+}
+
+// 32-bit int: the upper three bytes of each sample
+inline void s24_from_s32(const uint8_t *in, uint8_t *out, uint32_t num_samples) {
+	for (uint32_t i = 0; i < num_samples; i++)
+		std::memcpy(&out[i * 3], &in[i * 4 + 1], 3);
+}
+
+// 32-bit float: scaled by 8388607 and truncated, -1.0 and below is -8388608
+inline void s24_from_f32(const uint8_t *in, uint8_t *out, uint32_t num_samples) {
+	for (uint32_t i = 0; i < num_samples; i++) {
+		float f;
+		std::memcpy(&f, &in[i * 4], 4);
+		int32_t s = (f <= -1.f) ? -8388608 : (int32_t)(std::min(f, 1.f) * 8388607.f);
+		std::memcpy(&out[i * 3], &s, 3);
+	}
+}
+
+// Returns the converter for a sample format, or nullptr if the format is not supported.
+// PCM is the WAV format tag: 1 is integer, 3 is float
+inline Converter for_format(uint8_t sampleByteSize, uint16_t PCM) {
+	switch (sampleByteSize) {
+		case 1:
+			return u8;
+		case 2:
+			return s16;
+		case 3:
+			return s24;
+		case 4:
+			return (PCM == 3) ? f32 : (PCM == 1) ? s32 : nullptr;
+		default:
+			return nullptr;
+	}
+}
+
+// Returns the Store converter for a sample format and a play buffer format other than S16,
+// or nullptr if there is none
+inline Store for_storage(PlayFormat format, uint8_t sampleByteSize, uint16_t PCM) {
+	if (format == PlayFormat::S8)
+		return (sampleByteSize == 1) ? s8_from_u8 : nullptr;
+	if (format == PlayFormat::S24) {
+		switch (sampleByteSize) {
+			case 3:
+				return s24_from_s24;
+			case 4:
+				return (PCM == 3) ? s24_from_f32 : (PCM == 1) ? s24_from_s32 : nullptr;
+		}
+	}
+	return nullptr;
+}
+
+} // namespace SamplerKit::FormatConvert
@@ -0,0 +1,154 @@
+#pragma once
+#include "saturate.hh"
+#include <algorithm>
+#include <cstdint>
+#include <span>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Envelope, gain and output stage of SamplerAudio.
+// Targets with NEON process four frames per iteration, other targets use the scalar loops.
+namespace SamplerKit
+{
+
+#if defined(__ARM_NEON)
+namespace Neon
+{
+inline int32x4_t ssat24(int32x4_t x) {
+	return vminq_s32(vmaxq_s32(x, vdupq_n_s32(-(1 << 23))), vdupq_n_s32((1 << 23) - 1));
+}
+
+// (int32_t)(x * scale), saturated to 24 bits
+inline int32x4_t scale_sat24(int32x4_t x, float32x4_t scale) {
+	return ssat24(vcvtq_s32_f32(vmulq_f32(vcvtq_f32_s32(x), scale)));
+}
+} // namespace Neon
+#endif
+
+// Linear fade of stereo data in outL and outR
+// Gain is a fixed gain to apply to all samples
+// Set rate to < 0 to fade down, > 0 to fade up
+// Returns amplitude applied to the last sample
+// Note: this increments amplitude before applying to the first sample
+// starting_amp must be in [0, 1]
+inline float fade(std::span<int32_t> outL, std::span<int32_t> outR, float gain, float starting_amp, float rate) {
+	float amp = starting_amp;
+	unsigned i = 0;
+
+#if defined(__ARM_NEON)
+	// The amplitude of frame k is starting_amp + (k + 1) * rate, clamped. Because the amplitude
+	// only moves one way, this is the same as clamping after each step.
+	const float32x4_t steps = {1.f, 2.f, 3.f, 4.f};
+	const float32x4_t zero = vdupq_n_f32(0.f);
+	const float32x4_t one = vdupq_n_f32(1.f);
+	for (; i + 4 <= outL.size(); i += 4) {
+		float32x4_t amps = vminq_f32(vmaxq_f32(vmlaq_n_f32(vdupq_n_f32(amp), steps, rate), zero), one);
+		float32x4_t scale = vmulq_n_f32(amps, gain);
+		vst1q_s32(&outL[i], Neon::scale_sat24(vld1q_s32(&outL[i]), scale));
+		vst1q_s32(&outR[i], Neon::scale_sat24(vld1q_s32(&outR[i]), scale));
+		amp = vgetq_lane_f32(amps, 3);
+	}
+#endif
+
+	for (; i < outL.size(); i++) {
+		amp += rate;
+		if (amp >= 1.0f)
+			amp = 1.0f;
+		if (amp <= 0.f)
+			amp = 0.f;
+		outL[i] = (float)outL[i] * amp * gain;
+		outR[i] = (float)outR[i] * amp * gain;
+		outL[i] = ssat24(outL[i]);
+		outR[i] = ssat24(outR[i]);
+	}
+	return amp;
+}
+
+inline void apply_gain(std::span<int32_t> outL, std::span<int32_t> outR, float gain) {
+	unsigned i = 0;
+
+#if defined(__ARM_NEON)
+	const float32x4_t scale = vdupq_n_f32(gain);
+	for (; i + 4 <= outL.size(); i += 4) {
+		vst1q_s32(&outL[i], Neon::scale_sat24(vld1q_s32(&outL[i]), scale));
+		vst1q_s32(&outR[i], Neon::scale_sat24(vld1q_s32(&outR[i]), scale));
+	}
+#endif
+
+	for (; i < outL.size(); i++) {
+		outL[i] = (float)outL[i] * gain;
+		outR[i] = (float)outR[i] * gain;
+		outL[i] = ssat24(outL[i]);
+		outR[i] = ssat24(outR[i]);
+	}
+}
+
+// One block of the PLAY_FADEUP envelope. Without the fade up/down envelope, the note starts at full gain.
+// Returns true when the envelope has reached full level
+inline bool
+fade_up_block(std::span<int32_t> outL, std::span<int32_t> outR, float gain, float &env_level, float rate, bool env) {
+	if (!env) {
+		apply_gain(outL, outR, gain);
+		return true;
+	}
+	env_level = fade(outL, outR, gain, env_level, rate);
+	return env_level >= 1.f;
+}
+
+// One block of the PLAY_FADEDOWN envelope. Without the fade up/down envelope, the block plays at full gain
+// and the note ends after it.
+// Returns true when the envelope has reached zero
+inline bool
+fade_down_block(std::span<int32_t> outL, std::span<int32_t> outR, float gain, float &env_level, float rate, bool env) {
+	if (!env) {
+		apply_gain(outL, outR, gain);
+		env_level = 0.f;
+		return true;
+	}
+	env_level = fade(outL, outR, gain, env_level, -1.f * rate);
+	return env_level <= 0.f;
+}
+
+// Writes interleaved output frames {chan[0], chan[1]} for stereo mode:
+// chan[1] = -L, chan[0] = -R, saturated to 24 bits
+inline void write_stereo_out(std::span<int32_t> out, std::span<const int32_t> L, std::span<const int32_t> R) {
+	unsigned i = 0;
+
+#if defined(__ARM_NEON)
+	for (; i + 4 <= L.size(); i += 4) {
+		int32x4x2_t frames;
+		frames.val[0] = Neon::ssat24(vnegq_s32(vld1q_s32(&R[i])));
+		frames.val[1] = Neon::ssat24(vnegq_s32(vld1q_s32(&L[i])));
+		vst2q_s32(&out[i * 2], frames);
+	}
+#endif
+
+	for (; i < L.size(); i++) {
+		out[i * 2 + 1] = ssat24(-L[i]);
+		out[i * 2] = ssat24(-R[i]);
+	}
+}
+
+// Writes interleaved output frames {chan[0], chan[1]} for mono mode:
+// chan[1] = -L, chan[0] = L, saturated to 24 bits
+inline void write_mono_out(std::span<int32_t> out, std::span<const int32_t> L) {
+	unsigned i = 0;
+
+#if defined(__ARM_NEON)
+	for (; i + 4 <= L.size(); i += 4) {
+		int32x4x2_t frames;
+		frames.val[0] = Neon::ssat24(vld1q_s32(&L[i]));
+		frames.val[1] = Neon::ssat24(vnegq_s32(vld1q_s32(&L[i])));
+		vst2q_s32(&out[i * 2], frames);
+	}
+#endif
+
+	for (; i < L.size(); i++) {
+		out[i * 2 + 1] = ssat24(-L[i]);
+		out[i * 2] = ssat24(L[i]);
+	}
+}
+
+} // namespace SamplerKit
@@ -0,0 +1,16 @@
+#pragma once
+
+namespace SamplerKit
+{
+struct ResampleConf {
+	// Cortex-A7: float kernel, evaluating four outputs at a time with NEON
+	static constexpr bool IntegerKernel = false;
+	static constexpr bool VectorKernel = true;
+
+	// Unity pitch with a rational rate (44.1k on 48k): NEON float kernel with exact phase steps
+	static constexpr bool RationalKernel = true;
+
+	// Taps of the windowed-sinc kernel used in High resample quality (see tests/bench/resample_bench.cc for costs)
+	static constexpr unsigned SincTaps = 32;
+};
+} // namespace SamplerKit
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+namespace SamplerKit
+{
+
+// Copies with the CPU: the A7 runs with the data cache on, so a DMA transfer to the play buffers would need
+// cache maintenance that costs about as much as the NEON copy. start() finishes the copy, and busy() is never true.
+struct DmaCopy {
+	static void init() {}
+
+	static void start(const void *src, void *dst, uint32_t bytes) { std::memcpy(dst, src, bytes); }
+
+	static bool busy() { return false; }
+};
+
+} // namespace SamplerKit
@@ -0,0 +1,168 @@
+#pragma once
+#include "sample_type.hh"
+#include "wavefmt.hh"
+#include <algorithm>
+#include <cstdint>
+
+namespace SamplerKit
+{
+
+// Octave sidecars are 16-bit copies of a sample, decimated by 2, 4 and 8, stored in the system dir.
+// At high pitches the sampler streams a sidecar instead of the sample itself, so it reads 2-8x less
+// data from the SD card, and the sidecar's lowpass filter keeps the resampler from aliasing.
+namespace OctaveSidecar
+{
+constexpr uint8_t MaxLevel = 3;
+
+// Samples smaller than this are cached entirely in the play buffer, so sidecars would not help
+constexpr uint32_t MinSampleSize = 256 * 1024;
+
+// Highest level that can be built for a sample.
+// Sidecar sample rates must be exact, so the sample rate has to divide evenly.
+inline uint8_t max_level(const Sample &s) {
+	if (s.sampleSize < MinSampleSize || s.blockAlign == 0 || s.numChannels == 0 || s.numChannels > 2)
+		return 0;
+
+	uint8_t level = 0;
+	while (level < MaxLevel && (s.sampleRate % (2u << level)) == 0)
+		level++;
+	return level;
+}
+
+// Picks the level to stream at resample rate rs (rate relative to the sample itself).
+// ready_mask has bit n set if level n can be streamed (bit 0, the sample itself, is always ready)
+inline uint8_t choose_level(float rs, uint8_t ready_mask) {
+	uint8_t level = 0;
+	while (level < MaxLevel && rs >= (float)(2u << level) && (ready_mask & (2u << level)))
+		level++;
+	return level;
+}
+
+// Identifies the file and format a sidecar was built from, so sidecars of other or changed files are never used
+inline uint32_t source_id(const Sample &s) {
+	uint32_t hash = 2166136261u; // FNV-1a
+	auto add = [&hash](uint32_t byte) {
+		hash ^= byte & 0xFF;
+		hash *= 16777619u;
+	};
+	for (unsigned i = 0; i < sizeof(s.filename) && s.filename[i]; i++)
+		add(s.filename[i]);
+	for (uint32_t v : {s.sampleSize, s.sampleRate, (uint32_t)s.numChannels, (uint32_t)s.sampleByteSize, (uint32_t)s.PCM})
+	{
+		for (unsigned i = 0; i < 4; i++)
+			add(v >> (i * 8));
+	}
+	return hash;
+}
+
+// Number of frames in a sidecar: each decimation stage outputs ceil(n/2) frames
+constexpr uint32_t num_frames(uint32_t src_frames, uint8_t level) {
+	for (uint8_t i = 0; i < level; i++)
+		src_frames = (src_frames + 1) / 2;
+	return src_frames;
+}
+
+// Describes the level sidecar of src as a Sample, so playback can stream it like any other file.
+// All sizes, instrument points and cues are scaled to the sidecar.
+inline Sample sidecar_sample(const Sample &src, uint8_t level, const char *path) {
+	Sample s = src;
+	strncpy(s.filename, path, sizeof(s.filename) - 1);
+	s.filename[sizeof(s.filename) - 1] = 0;
+
+	s.sampleRate = src.sampleRate >> level;
+	s.sampleByteSize = 2;
+	s.PCM = 1;
+	s.blockAlign = 2 * src.numChannels;
+	s.startOfData = sizeof(WaveHeaderAndChunk);
+	s.sampleSize = num_frames(src.sampleSize / src.blockAlign, level) * s.blockAlign;
+
+	auto scale = [&](uint32_t pos) { return std::min(((pos / src.blockAlign) >> level) * s.blockAlign, s.sampleSize); };
+	s.inst_start = scale(src.inst_start);
+	s.inst_end = scale(src.inst_end);
+	s.inst_size = s.inst_end - s.inst_start;
+
+	for (unsigned i = 0; i < s.num_cues; i++)
+		s.cue[i] = src.cue[i] >> level;
+
+	s.file_status = FileStatus::Found;
+	return s;
+}
+
+// Decimates interleaved 16-bit audio by 2 with a 31-tap halfband lowpass
+// (flat to 0.35 and -53dB from 0.65 of the input Nyquist frequency).
+// The output is aligned with the input: output frame m is centered on input frame 2m,
+// so positions scale exactly by 2. Call flush() after the last input to get the final outputs.
+class HalfbandDecimator {
+	static constexpr unsigned MaxChans = 2;
+	static constexpr unsigned NumTaps = 31;
+	static constexpr unsigned Delay = NumTaps / 2;
+
+	// Taps at odd distances 1, 3, 5... from the center (the center tap is 0.5, and taps at even distances are 0), Q15
+	static constexpr int32_t Taps[] = {10258, -2989, 1361, -630, 263, -90, 21, -2};
+
+	// History of each channel, written twice so the last NumTaps samples are always contiguous
+	int16_t hist[MaxChans][NumTaps * 2]{};
+	unsigned pos = 0;
+	unsigned num_chans = 1;
+	uint32_t frames_in = 0;
+	uint32_t frames_out = 0;
+
+	int16_t filter(unsigned chan) const {
+		// window[Delay] is the center, window[NumTaps-1] the newest input
+		const int16_t *window = &hist[chan][pos];
+		int32_t acc = window[Delay] * 16384;
+		for (unsigned i = 0; i < sizeof(Taps) / sizeof(Taps[0]); i++) {
+			unsigned d = i * 2 + 1;
+			acc += Taps[i] * (window[Delay - d] + window[Delay + d]);
+		}
+		return (int16_t)std::clamp((acc + (1 << 14)) >> 15, (int32_t)INT16_MIN, (int32_t)INT16_MAX);
+	}
+
+	void push(const int16_t *frame, int16_t *&out) {
+		for (unsigned c = 0; c < num_chans; c++) {
+			hist[c][pos] = frame[c];
+			hist[c][pos + NumTaps] = frame[c];
+		}
+		pos = (pos + 1) % NumTaps;
+
+		// Output m is due once input 2m + Delay has arrived
+		if (frames_in >= Delay && ((frames_in - Delay) & 1) == 0) {
+			for (unsigned c = 0; c < num_chans; c++)
+				*out++ = filter(c);
+			frames_out++;
+		}
+		frames_in++;
+	}
+
+public:
+	void reset(unsigned chans) {
+		num_chans = std::clamp(chans, 1u, MaxChans);
+		for (auto &h : hist)
+			std::fill(h, h + NumTaps * 2, 0);
+		pos = 0;
+		frames_in = 0;
+		frames_out = 0;
+	}
+
+	// Decimates frames interleaved frames from in to out. out may be the same as in.
+	// Returns the number of frames written to out
+	uint32_t process(const int16_t *in, uint32_t frames, int16_t *out) {
+		int16_t *start = out;
+		for (uint32_t i = 0; i < frames; i++)
+			push(&in[i * num_chans], out);
+		return (out - start) / num_chans;
+	}
+
+	// Writes the outputs still pending after the last input (at most Delay / 2 + 1 frames)
+	uint32_t flush(int16_t *out) {
+		const int16_t zeros[MaxChans]{};
+		int16_t *start = out;
+		uint32_t total = (frames_in + 1) / 2;
+		while (frames_out < total)
+			push(zeros, out);
+		return (out - start) / num_chans;
+	}
+};
+
+} // namespace OctaveSidecar
+} // namespace SamplerKit
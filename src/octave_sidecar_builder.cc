@@ -0,0 +1,207 @@
+#include "octave_sidecar_builder.hh"
+#include "str_util.h"
+#include "wavefmt.hh"
+
+namespace SamplerKit
+{
+
+void OctaveSidecarBuilder::update() {
+	if (building)
+		build_chunk();
+	else
+		scan_next_slot();
+}
+
+// Path is SYS_DIR/oct-XXXXXXXX-L.wav, where XXXXXXXX is the source id in hex and L is the level
+void OctaveSidecarBuilder::make_path(char *path, uint32_t id, uint8_t level) {
+	char name[20] = "oct-XXXXXXXX-0.wav";
+	for (unsigned i = 0; i < 8; i++)
+		name[4 + i] = "0123456789abcdef"[(id >> ((7 - i) * 4)) & 0xF];
+	name[13] = '0' + level;
+	str_cat(path, SYS_DIR_SLASH, name);
+}
+
+void OctaveSidecarBuilder::scan_next_slot() {
+	uint8_t slot = scan_slot;
+	scan_slot = (scan_slot + 1) % NumSamplesPerBank;
+
+	uint8_t bank = params.bank;
+	Sample &s = samples[bank][slot];
+	if (s.filename[0] == 0 || s.file_status == FileStatus::NotFound)
+		return;
+
+	uint32_t id = OctaveSidecar::source_id(s);
+	auto &st = status[slot];
+	if (st.bank == bank && st.id == id && (st.ready_mask || st.failed))
+		return;
+
+	st = SlotStatus{.bank = bank, .id = id, .ready_mask = 1, .failed = false};
+
+	uint8_t num_levels = OctaveSidecar::max_level(s);
+	if (num_levels == 0)
+		return;
+
+	if (sd.check_sys_dir() != FR_OK) {
+		st.failed = true;
+		return;
+	}
+
+	// A sidecar is complete if its size is exactly what it would be if we built it now
+	uint8_t missing = 0;
+	for (uint8_t level = 1; level <= num_levels; level++) {
+		char path[FF_MAX_LFN];
+		make_path(path, id, level);
+		Sample side = OctaveSidecar::sidecar_sample(s, level, path);
+
+		FILINFO info;
+		if (f_stat(path, &info) == FR_OK && info.fsize == side.startOfData + side.sampleSize)
+			st.ready_mask |= 1 << level;
+		else
+			missing |= 1 << level;
+	}
+
+	if (missing)
+		start_build(slot, s, num_levels, missing);
+}
+
+void OctaveSidecarBuilder::start_build(uint8_t slot, const Sample &s, uint8_t num_levels, uint8_t write_mask) {
+	build_sample = s;
+	build_slot = slot;
+	build_num_levels = num_levels;
+	build_write_mask = 0;
+
+	build_convert = FormatConvert::for_format(s.sampleByteSize, s.PCM);
+	if (!build_convert) {
+		status[slot].failed = true;
+		return;
+	}
+
+	if (f_open(&src_fil, s.filename, FA_READ) != FR_OK) {
+		status[slot].failed = true;
+		return;
+	}
+
+	if (f_size(&src_fil) < (s.startOfData + s.sampleSize) || f_lseek(&src_fil, s.startOfData) != FR_OK) {
+		f_close(&src_fil);
+		status[slot].failed = true;
+		return;
+	}
+
+	uint32_t id = OctaveSidecar::source_id(s);
+	for (uint8_t level = 1; level <= num_levels; level++) {
+		decimator[level - 1].reset(s.numChannels);
+
+		if (!(write_mask & (1 << level)))
+			continue;
+
+		char path[FF_MAX_LFN];
+		make_path(path, id, level);
+		Sample side = OctaveSidecar::sidecar_sample(s, level, path);
+
+		// The sizes are known in advance, so the header is final. An interrupted build leaves a file
+		// that is too short, which the next scan will rebuild.
+		WaveHeaderAndChunk whac;
+		create_waveheader(&whac.wh, &whac.fc, 16, side.numChannels, side.sampleRate);
+		create_chunk(ccDATA, side.sampleSize, &whac.wc);
+		whac.wh.fileSize = sizeof(WaveHeaderAndChunk) - 8 + side.sampleSize;
+
+		UINT bw;
+		FRESULT res = f_open(&dst_fil[level - 1], path, FA_CREATE_ALWAYS | FA_WRITE);
+		if (res == FR_OK) {
+			build_write_mask |= 1 << level;
+			res = f_write(&dst_fil[level - 1], &whac, sizeof(whac), &bw);
+		}
+		if (res != FR_OK || bw != sizeof(whac)) {
+			building = true;
+			finish_build(false);
+			return;
+		}
+	}
+
+	src_bytes_left = s.sampleSize - (s.sampleSize % s.blockAlign);
+	building = true;
+}
+
+// Reads one chunk of the source, converts it to 16-bit and runs it down the decimator cascade.
+// Each level decimates the output of the level above it in place.
+void OctaveSidecarBuilder::build_chunk() {
+	const Sample &s = build_sample;
+
+	// Stop if the bank changed, or a new sample was recorded or assigned to the slot
+	auto &st = status[build_slot];
+	if (params.bank != st.bank || OctaveSidecar::source_id(samples[params.bank][build_slot]) != st.id) {
+		finish_build(false);
+		st = SlotStatus{};
+		return;
+	}
+
+	uint32_t bytes = std::min(src_bytes_left, ReadChunkBytes);
+	bool last_chunk = (bytes == src_bytes_left);
+
+	UINT br;
+	if (f_read(&src_fil, read_buf, bytes, &br) != FR_OK || br != bytes) {
+		finish_build(false);
+		return;
+	}
+	src_bytes_left -= bytes;
+
+	const uint32_t num_samples = bytes / s.sampleByteSize;
+	build_convert(read_buf, conv_buf, num_samples);
+	uint32_t frames = num_samples / s.numChannels;
+
+	for (uint8_t level = 1; level <= build_num_levels; level++) {
+		auto &dec = decimator[level - 1];
+		frames = dec.process(conv_buf, frames, conv_buf);
+		if (last_chunk)
+			frames += dec.flush(&conv_buf[frames * s.numChannels]);
+
+		if (build_write_mask & (1 << level)) {
+			UINT bw;
+			UINT len = frames * s.numChannels * sizeof(int16_t);
+			if (f_write(&dst_fil[level - 1], conv_buf, len, &bw) != FR_OK || bw != len) {
+				finish_build(false);
+				return;
+			}
+		}
+	}
+
+	if (last_chunk)
+		finish_build(true);
+}
+
+void OctaveSidecarBuilder::finish_build(bool ok) {
+	f_close(&src_fil);
+
+	uint32_t id = OctaveSidecar::source_id(build_sample);
+	for (uint8_t level = 1; level <= build_num_levels; level++) {
+		if (!(build_write_mask & (1 << level)))
+			continue;
+
+		char path[FF_MAX_LFN];
+		make_path(path, id, level);
+		Sample side = OctaveSidecar::sidecar_sample(build_sample, level, path);
+
+		ok = ok && (f_size(&dst_fil[level - 1]) == side.startOfData + side.sampleSize);
+		if (f_close(&dst_fil[level - 1]) != FR_OK)
+			ok = false;
+	}
+
+	auto &st = status[build_slot];
+	if (ok)
+		st.ready_mask |= build_write_mask;
+	else {
+		// Don't leave partial files around, and don't retry until the sample changes
+		for (uint8_t level = 1; level <= build_num_levels; level++) {
+			if (build_write_mask & (1 << level)) {
+				char path[FF_MAX_LFN];
+				make_path(path, id, level);
+				f_unlink(path);
+			}
+		}
+		st.failed = true;
+	}
+
+	building = false;
+}
+
+} // namespace SamplerKit
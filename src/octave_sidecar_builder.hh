@@ -0,0 +1,89 @@
+#pragma once
+#include "ff.h"
+#include "format_convert.hh"
+#include "octave_sidecar.hh"
+#include "params.hh"
+#include "sample_file.hh"
+#include "sdcard.hh"
+#include <array>
+
+namespace SamplerKit
+{
+
+// Builds the octave sidecars of the samples in the current bank, one chunk at a time from the main loop,
+// and keeps track of which sidecars are ready to be played.
+// Sidecar files are named after the source_id of the sample, so a sidecar is never played for a different
+// file, and a sidecar that is being played is never overwritten.
+class OctaveSidecarBuilder {
+	Sdcard &sd;
+	SampleList &samples;
+	Params &params;
+
+	struct SlotStatus {
+		uint32_t bank = 0;
+		uint32_t id = 0;
+		uint8_t ready_mask = 0; // bit n is set if the level n sidecar is ready. 0 means not scanned yet
+		bool failed = false;
+	};
+	std::array<SlotStatus, NumSamplesPerBank> status{};
+	uint8_t scan_slot = 0;
+
+	// Build in progress
+	bool building = false;
+	uint8_t build_slot = 0;
+	uint8_t build_num_levels = 0;
+	uint8_t build_write_mask = 0;
+	uint32_t src_bytes_left = 0;
+	FormatConvert::Converter build_convert = nullptr;
+	Sample build_sample;
+	FIL src_fil;
+	FIL dst_fil[OctaveSidecar::MaxLevel];
+	OctaveSidecar::HalfbandDecimator decimator[OctaveSidecar::MaxLevel];
+
+	// Divisible by every blockAlign (1, 2, 3, 4, 6 and 8 bytes)
+	static constexpr uint32_t ReadChunkBytes = 3072;
+	alignas(4) uint8_t read_buf[ReadChunkBytes];
+	int16_t conv_buf[ReadChunkBytes];
+
+public:
+	OctaveSidecarBuilder(Sdcard &sd, SampleList &samples, Params &params)
+		: sd{sd}
+		, samples{samples}
+		, params{params} {}
+
+	// Returns a mask of the levels which can be streamed for a sample (bit 0, the sample itself, is always set)
+	uint8_t ready_levels(uint8_t bank, uint8_t slot, const Sample &s) const {
+		auto &st = status[slot];
+		if (st.bank != bank || st.id != OctaveSidecar::source_id(s))
+			return 1;
+		return st.ready_mask | 1;
+	}
+
+	// Describes the level sidecar of a sample, including its path
+	static Sample sidecar_sample(const Sample &s, uint8_t level) {
+		char path[FF_MAX_LFN];
+		make_path(path, OctaveSidecar::source_id(s), level);
+		return OctaveSidecar::sidecar_sample(s, level, path);
+	}
+
+	// Stop using the sidecars of a slot, e.g. when one of them fails to open.
+	// They are checked again when the slot's sample changes
+	void invalidate(uint8_t slot) {
+		if (!(building && build_slot == slot)) {
+			status[slot].ready_mask = 1;
+			status[slot].failed = true;
+		}
+	}
+
+	// Does one step of work: checks one slot for missing sidecars, or converts one chunk of a sidecar
+	void update();
+
+private:
+	static void make_path(char *path, uint32_t id, uint8_t level);
+	void scan_next_slot();
+	void start_build(uint8_t slot, const Sample &s, uint8_t num_levels, uint8_t write_mask);
+	void build_chunk();
+	void finish_build(bool ok);
+};
+
+} // namespace SamplerKit
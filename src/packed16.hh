@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+
+#if defined(ARM_MATH_CM7)
+#include "drivers/stm32xx.h"
+#endif
+
+namespace SamplerKit
+{
+
+// Packed 16-bit helpers for the integer resampler and the format converters.
+// On Cortex-M7 these are single DSP-extension instructions, elsewhere they are plain C.
+namespace Packed16
+{
+// acc + x.lo * y.lo + x.hi * y.hi
+inline int32_t smlad(uint32_t x, uint32_t y, int32_t acc) {
+#if defined(ARM_MATH_CM7)
+	return __SMLAD(x, y, acc);
+#else
+	return acc + (int16_t)(x & 0xFFFF) * (int16_t)(y & 0xFFFF) + (int16_t)(x >> 16) * (int16_t)(y >> 16);
+#endif
+}
+
+// {lo.lo, hi.lo}
+inline uint32_t pack_lo(uint32_t lo, uint32_t hi) {
+#if defined(ARM_MATH_CM7)
+	return __PKHBT(lo, hi, 16);
+#else
+	return (lo & 0xFFFF) | (hi << 16);
+#endif
+}
+
+// {lo.hi, hi.hi}
+inline uint32_t pack_hi(uint32_t lo, uint32_t hi) {
+#if defined(ARM_MATH_CM7)
+	return __PKHTB(hi, lo, 16);
+#else
+	return (hi & 0xFFFF0000) | (lo >> 16);
+#endif
+}
+} // namespace Packed16
+
+} // namespace SamplerKit
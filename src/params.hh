@@ -48,6 +48,7 @@ struct Params {
 	bool looping = 0;
 
 	float pitch = 1.0f;
+	bool unity_pitch = true; // set with pitch, see TuningCalcs::is_unity_pitch()
 	float start = 0.f;
 	float length = 1.f;
 	float volume = 1.f;
@@ -139,6 +140,8 @@ private:
 			pitch = pitch_pot_lut[potval] * TuningCalcs::quantized_semitone_voct(compensated_pitch_cv);
 		else
 			pitch = pitch_pot_lut[potval] * voltoct[compensated_pitch_cv];
+
+		unity_pitch = TuningCalcs::is_unity_pitch(pitch);
 	}
 
 	void update_length() {
@@ -0,0 +1,91 @@
+#pragma once
+#include "circular_buffer.hh"
+#include <cstdint>
+
+namespace SamplerKit
+{
+
+// Copies 16-bit samples from the loader's read buffer to a play buffer with memory-to-memory DMA,
+// so the main loop can get on with other work while the SDRAM is written.
+//
+// Dma is the target's driver (see dma_copy.hh), with start(src, dst, bytes) and busy(). The copy is split
+// where the in ptr wraps into at most two transfers, and poll() starts the second when the first is done.
+// The in ptr is advanced by start(), but the data is not in the play buffer until poll() returns true, and the
+// audio ISR doesn't see it until finish() publishes it.
+template<typename Dma>
+class PlayBuffDma {
+public:
+	// Starts copying num_samples 16-bit samples from src to buf's in ptr, and advances the in ptr.
+	// Returns 1 if it overwrote data not yet played (see CircularBuffer::write_runs())
+	uint32_t start(CircularBuffer &buf, const int16_t *src, uint32_t num_samples) {
+		num_runs = 0;
+		next_run = 0;
+		uint32_t crossed = buf.write_runs(num_samples, 2, false, [&](uint32_t dst, uint32_t pos, uint32_t count) {
+			runs[num_runs++] = {&src[pos], dst, count * 2};
+		});
+		pending_buf = &buf;
+		pending_src = src;
+		pending_bytes = num_samples * 2;
+		start_next();
+		return crossed;
+	}
+
+	// Starts the next transfer if the last one finished. Returns true once the whole copy is done
+	bool poll() {
+		if (Dma::busy())
+			return false;
+		if (next_run < num_runs) {
+			start_next();
+			return false;
+		}
+		return true;
+	}
+
+	void wait() {
+		while (!poll())
+			;
+	}
+
+	// Publishes the copy to the audio ISR once it's done. With wait set, it waits for the copy.
+	// Returns the play buffer it published to, or nullptr if the copy is still running (or there is none)
+	CircularBuffer *finish(bool wait) {
+		if (!pending_buf)
+			return nullptr;
+		if (wait)
+			this->wait();
+		else if (!poll())
+			return nullptr;
+		auto buf = pending_buf;
+		pending_buf = nullptr;
+		buf->written(pending_bytes);
+		return buf;
+	}
+
+	bool pending() const { return pending_buf != nullptr; }
+
+	// Whether the copy is still reading from src
+	bool copying_from(const void *src) const { return pending_buf && pending_src == src; }
+
+private:
+	void start_next() {
+		if (next_run < num_runs) {
+			auto &r = runs[next_run++];
+			Dma::start(r.src, reinterpret_cast<int16_t *>(r.dst), r.bytes);
+		}
+	}
+
+	struct Run {
+		const int16_t *src;
+		uint32_t dst;
+		uint32_t bytes;
+	};
+	Run runs[2]{};
+	uint32_t num_runs = 0;
+	uint32_t next_run = 0;
+
+	CircularBuffer *pending_buf = nullptr;
+	const void *pending_src = nullptr;
+	uint32_t pending_bytes = 0;
+};
+
+} // namespace SamplerKit
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+
+namespace SamplerKit
+{
+
+// How samples are stored in a play buffer.
+// 8-bit files are kept as 8-bit, so they get twice the cache of a 16-bit file in the same memory.
+// 24-bit and 32-bit files are stored as 16-bit, or as packed 24-bit if UserSettings::play_24bits is set.
+// Files of 16 bits or more are stored as 4-bit ADPCM blocks if UserSettings::compress_cache is set (see adpcm.hh).
+enum class PlayFormat : uint8_t { S16, S8, S24, Adpcm };
+
+// Reads one sample of a PlayFormat.
+// load() returns signed 24-bit, like the resampler outputs. load16() returns the top 16 bits as a raw halfword,
+// for the integer kernels
+template<PlayFormat F>
+struct PlayStorage;
+
+template<>
+struct PlayStorage<PlayFormat::S16> {
+	static constexpr uint32_t Bytes = 2;
+	static int32_t load(uint32_t addr) { return (int32_t)(*reinterpret_cast<int16_t *>(addr)) * 256; }
+	static uint32_t load16(uint32_t addr) { return *reinterpret_cast<uint16_t *>(addr); }
+};
+
+template<>
+struct PlayStorage<PlayFormat::S8> {
+	static constexpr uint32_t Bytes = 1;
+	static int32_t load(uint32_t addr) { return (int32_t)(*reinterpret_cast<int8_t *>(addr)) * 65536; }
+	static uint32_t load16(uint32_t addr) { return (uint32_t)(*reinterpret_cast<uint8_t *>(addr)) << 8; }
+};
+
+// Packed 24-bit samples are not aligned, so they are read one byte at a time
+template<>
+struct PlayStorage<PlayFormat::S24> {
+	static constexpr uint32_t Bytes = 3;
+	static int32_t load(uint32_t addr) {
+		auto *p = reinterpret_cast<uint8_t *>(addr);
+		return (int32_t)((p[0] << 8) | (p[1] << 16) | (p[2] << 24)) >> 8;
+	}
+	static uint32_t load16(uint32_t addr) {
+		auto *p = reinterpret_cast<uint8_t *>(addr);
+		return p[1] | (p[2] << 8);
+	}
+};
+
+// ADPCM play buffers are addressed as if they held 16-bit samples. The samples are read through the buffer's
+// AdpcmStore, which maps the addresses to the compressed blocks, so there is no load() here
+template<>
+struct PlayStorage<PlayFormat::Adpcm> {
+	static constexpr uint32_t Bytes = 2;
+};
+
+// Bytes per sample in play buffer addresses
+constexpr uint32_t play_bytes(PlayFormat f) {
+	return f == PlayFormat::S8 ? 1 : f == PlayFormat::S24 ? 3 : 2;
+}
+
+// Bytes of mem_bytes a play buffer can use: a whole number of frames, so a packed 24-bit sample never straddles
+// the end of the buffer, and the play address wraps onto the start of a frame
+constexpr uint32_t whole_frame_bytes(uint32_t mem_bytes, PlayFormat f, uint32_t channels) {
+	uint32_t frame_bytes = play_bytes(f) * (channels ? channels : 1);
+	return mem_bytes - mem_bytes % frame_bytes;
+}
+
+// Storage format for a sample file with sampleByteSize bytes per sample
+constexpr PlayFormat play_format_for(uint8_t sampleByteSize, bool play_24bits, bool compress_cache = false) {
+	if (sampleByteSize == 1)
+		return PlayFormat::S8;
+	if (sampleByteSize >= 3 && play_24bits)
+		return PlayFormat::S24;
+	if (compress_cache)
+		return PlayFormat::Adpcm;
+	return PlayFormat::S16;
+}
+
+} // namespace SamplerKit
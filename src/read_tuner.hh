@@ -0,0 +1,125 @@
+#pragma once
+#include "elements.hh"
+#include <algorithm>
+#include <cstdint>
+
+namespace SamplerKit
+{
+
+// Measures how fast the SD card delivers sample file reads, and sizes the loader's reads and buffer targets from it.
+//
+// Throughput is averaged over the last WindowBytes read, and the worst latency of a single read is kept with a
+// slow decay, so a card that stalls now and then (wear leveling, garbage collection) keeps a deeper buffer for
+// a while after a stall. Times are in ms (HAL_GetTick), so short reads are averaged rather than timed one by one.
+class ReadTuner {
+public:
+	// Read sizes are multiples of 1536: a whole number of 512-byte sectors, and of all sample block sizes
+	// (see READ_BLOCK_SIZE)
+	static constexpr uint32_t ReadGranule = 1536;
+	static constexpr uint32_t MinReadSize = ReadGranule * 2;
+	static constexpr uint32_t MaxReadSize = READ_BLOCK_SIZE;
+
+	// Reverse chunks that go straight into play_buff can be larger than the read buffers, since each one costs a seek
+	static constexpr uint32_t MaxReverseReadSize = READ_BLOCK_SIZE * 4;
+
+	// Length of audio each read brings in, if the card is fast enough for small reads
+	static constexpr uint32_t ReadAheadMs = 16;
+
+	static constexpr uint32_t WindowBytes = 64 * 1024;
+
+	// The worst latency drops by 1ms after this many reads without a slower one
+	static constexpr uint32_t LatencyDecayReads = 64;
+
+	// Added to the worst latency for the prebuffer amount: a read timed at n ms with HAL_GetTick can take up to
+	// n + 1 ms, and the next read starts up to 1ms after the buffer dips below the threshold
+	static constexpr uint32_t LatencyMarginMs = 2;
+
+	// Seeds the throughput with a read timed when the card was mounted
+	void set_card_speed(uint32_t bytes, uint32_t ms) {
+		if (ms)
+			bytes_per_ms = bytes / ms;
+	}
+
+	void record_read(uint32_t bytes, uint32_t ms) {
+		window_bytes += bytes;
+		window_ms += ms;
+		if (window_bytes >= WindowBytes) {
+			bytes_per_ms = window_bytes / std::max<uint32_t>(window_ms, 1);
+			window_bytes = 0;
+			window_ms = 0;
+		}
+
+		if (ms >= worst_ms) {
+			worst_ms = ms;
+			reads_since_worst = 0;
+		} else if (++reads_since_worst >= LatencyDecayReads) {
+			worst_ms--;
+			reads_since_worst = 0;
+		}
+		measured = true;
+	}
+
+	uint32_t throughput() const { return bytes_per_ms; }
+	uint32_t worst_latency() const { return worst_ms; }
+
+	// Bytes to read at a time for a stream that plays file_rate bytes of its file per ms.
+	// Small reads hold up the main loop for less time, but cost more per byte: a card less than 4x faster than
+	// the stream gets the largest reads.
+	uint32_t read_size(float file_rate) const {
+		if (bytes_per_ms && bytes_per_ms < file_rate * 4.f)
+			return MaxReadSize;
+		uint32_t granules = (uint32_t)(file_rate * ReadAheadMs) / ReadGranule + 1;
+		return std::clamp(granules * ReadGranule, MinReadSize, MaxReadSize);
+	}
+
+	// Play buffer bytes to load before playing, for a stream that plays play_rate bytes of its play_buff per ms:
+	// enough to ride out the slowest recent read. It's never less than base_amt (the hand-tuned amount), so a fast
+	// card that measures at 0-1ms still keeps a margin for the occasional slow read.
+	uint32_t prebuffer(float play_rate, uint32_t base_amt) const {
+		if (!measured)
+			return base_amt;
+		return std::max(base_amt, (uint32_t)(play_rate * (worst_ms + LatencyMarginMs)));
+	}
+
+	// Bytes to read from file position fptr, at most max_rd, so that the read ends on a sector boundary that is
+	// also on a sample block boundary (counting from data_start). FatFs reads whole sectors straight from the card
+	// into the destination, but goes through its sector window for a partial sector at either end. Once a read
+	// ends aligned, reads of a multiple of ReadGranule stay aligned, so only the first read of a run is shortened.
+	// Returns max_rd if there's no such boundary within it.
+	// (reverse_aligned_read() is the same for reads that end at a position, and start up to max_rd before it)
+	static constexpr uint32_t sector_aligned_read(uint32_t fptr, uint32_t max_rd, uint32_t data_start,
+												  uint32_t block_align) {
+		if (!block_align)
+			return max_rd;
+		uint32_t end = (fptr + max_rd) & ~(SectorSize - 1);
+		for (; end > fptr; end -= SectorSize) {
+			if ((end - data_start) % block_align == 0)
+				return end - fptr;
+		}
+		return max_rd;
+	}
+
+	static constexpr uint32_t reverse_aligned_read(uint32_t end, uint32_t max_rd, uint32_t data_start,
+												   uint32_t block_align) {
+		if (!block_align)
+			return max_rd;
+		uint32_t begin = (end - max_rd + SectorSize - 1) & ~(SectorSize - 1);
+		for (; begin < end; begin += SectorSize) {
+			if ((begin - data_start) % block_align == 0)
+				return end - begin;
+		}
+		return max_rd;
+	}
+
+private:
+	static constexpr uint32_t SectorSize = 512;
+
+	uint32_t bytes_per_ms = 0;
+	uint32_t window_bytes = 0;
+	uint32_t window_ms = 0;
+	uint32_t worst_ms = 0;
+	uint32_t reads_since_worst = 0;
+	bool measured = false;
+};
+
+} // namespace SamplerKit
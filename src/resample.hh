@@ -26,10 +26,20 @@
  * -----------------------------------------------------------------------------
  */
 
+#pragma once
+#include "adpcm.hh"
 #include "circular_buffer.hh"
+#include "packed16.hh"
+#include "play_format.hh"
+#include "saturate.hh"
 #include <algorithm>
+#include <array>
 #include <span>
 
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace SamplerKit
 {
 
@@ -43,39 +53,63 @@ static inline void inc_play_addr(CircularBuffer *buf, bool reverse) {
 		buf->out += BlockAlign;
 
 		// This will not work if buf->max==0xFFFFFFFF, but luckily this is never the case with the STS!
-		if (buf->out >= buf->max) {
-			buf->wrapping = 0;
+		if (buf->out >= buf->max)
 			buf->out -= buf->size;
-		}
 	} else {
-		if ((buf->out - buf->min) < BlockAlign) {
+		if ((buf->out - buf->min) < BlockAlign)
 			buf->out += buf->size - BlockAlign;
-			buf->wrapping = 1;
-		} else
+		else
 			buf->out -= BlockAlign;
 	}
 }
 
-enum class WavChan { Left, Right, Average, Mono };
+// Moves the play address by any number of frames with a single wrap check.
+// frames * BlockAlign must be less than buf->size
+template<int32_t BlockAlign>
+static inline void offset_play_addr(CircularBuffer *buf, uint32_t frames, bool reverse) {
+	uint32_t amt = frames * BlockAlign;
+	if (!reverse) {
+		buf->out += amt;
+		if (buf->out >= buf->max)
+			buf->out -= buf->size;
+	} else {
+		if ((buf->out - buf->min) < amt)
+			buf->out += buf->size - amt;
+		else
+			buf->out -= amt;
+	}
+}
+
+enum class WavChan { Left, Right, Average, Mono, Stereo };
 
-// Reads signed 16-bit and returns signed 24-bit stored in an int32_t
-template<WavChan Chan>
+// Reads one sample in the play buffer format F and returns signed 24-bit stored in an int32_t
+template<WavChan Chan, PlayFormat F = PlayFormat::S16>
 inline int32_t get_sample(uint32_t addr) {
 	wait_memory_ready();
 
+	if constexpr (F != PlayFormat::S16) {
+		using S = PlayStorage<F>;
+		if constexpr (Chan == WavChan::Left || Chan == WavChan::Mono)
+			return S::load(addr);
+		else if constexpr (Chan == WavChan::Right)
+			return S::load(addr + S::Bytes);
+		else
+			return (S::load(addr) + S::load(addr + S::Bytes)) >> 1;
+	}
+
 	int16_t r;
 
 	if constexpr (Chan == WavChan::Left || Chan == WavChan::Mono) {
-		r = *((int16_t *)addr);
+		r = *reinterpret_cast<int16_t *>(addr);
 		return ((int32_t)r) * 256;
 
 	} else if constexpr (Chan == WavChan::Right) {
-		r = *((int16_t *)(addr + 2));
+		r = *reinterpret_cast<int16_t *>(addr + 2);
 		return ((int32_t)r) * 256;
 
 	} else {
 		// Average:
-		uint32_t rd = (*((uint32_t *)addr));
+		uint32_t rd = *reinterpret_cast<uint32_t *>(addr);
 		int16_t a = (rd >> 16);
 		int16_t b = (rd & 0x0000FFFF);
 		int32_t t = a + b;
@@ -83,133 +117,818 @@ inline int32_t get_sample(uint32_t addr) {
 	}
 }
 
-// TODO: get rid of block_align and use Chan:
-// Average => 4
-// Left/Right => 4
-// Mono => 2
-// template<Chan chan>
-// void resample_read(
-// 	float rs, CircularBuffer *buf, std::span<int32_t> outbuf, uint32_t block_align, bool rev, bool flush) {
-// 	uint32_t buff_len = outbuf.size();
-// 	_resample_read<chan>(rs, buf, buff_len, block_align, outbuf.data(), rev, flush);
-// }
-
-template<WavChan Chan>
-void resample_read(float rs, CircularBuffer *buf, std::span<int32_t> outbuf, bool rev, bool flush) {
-	static float fractional_pos = 0;
-	static float xm1, x0, x1, x2;
-	float a, b, c;
-	uint32_t outpos;
-	float t_out;
-
-	uint32_t buff_len = outbuf.size();
-	int32_t *out = outbuf.data();
-	constexpr uint32_t BlockAlign = (Chan == WavChan::Mono) ? 2 : 4;
-
-	if (rs == 1.f) {
-		for (outpos = 0; outpos < buff_len; outpos++) {
+// Reads one interleaved L/R frame (with a single 32-bit access for 16-bit),
+// and returns both channels as signed 24-bit
+struct StereoFrame {
+	int32_t l;
+	int32_t r;
+};
+
+template<PlayFormat F = PlayFormat::S16>
+inline StereoFrame get_stereo_frame(uint32_t addr) {
+	wait_memory_ready();
+
+	if constexpr (F != PlayFormat::S16) {
+		using S = PlayStorage<F>;
+		return {S::load(addr), S::load(addr + S::Bytes)};
+	}
+
+	uint32_t rd = *reinterpret_cast<uint32_t *>(addr);
+	int16_t l = (rd & 0x0000FFFF);
+	int16_t r = (rd >> 16);
+	return {((int32_t)l) * 256, ((int32_t)r) * 256};
+}
+
+// Reads at the out ptr of buf. ADPCM is decoded here, so it's fused into the kernel's read
+template<WavChan Chan, PlayFormat F>
+inline int32_t get_sample(CircularBuffer *buf) {
+	if constexpr (F == PlayFormat::Adpcm) {
+		const int16_t *f = buf->adpcm->frame(buf->out);
+		if constexpr (Chan == WavChan::Left || Chan == WavChan::Mono)
+			return (int32_t)f[0] * 256;
+		else if constexpr (Chan == WavChan::Right)
+			return (int32_t)f[1] * 256;
+		else
+			return ((int32_t)f[0] + f[1]) * 128;
+	} else
+		return get_sample<Chan, F>(buf->out);
+}
+
+template<PlayFormat F>
+inline StereoFrame get_stereo_frame(CircularBuffer *buf) {
+	if constexpr (F == PlayFormat::Adpcm) {
+		const int16_t *f = buf->adpcm->frame(buf->out);
+		return {(int32_t)f[0] * 256, (int32_t)f[1] * 256};
+	} else
+		return get_stereo_frame<F>(buf->out);
+}
+
+// Bytes per frame in the play buffer
+template<WavChan Chan, PlayFormat F = PlayFormat::S16>
+inline constexpr uint32_t frame_bytes = (Chan == WavChan::Mono ? 1 : 2) * PlayStorage<F>::Bytes;
+
+// Interpolation history and fractional position of one channel of a playback stream.
+// Each stream that is resampled owns one of these per channel, so several streams can be
+// resampled in the same audio block without sharing history.
+struct ResamplerState {
+	float xm1 = 0.f;
+	float x0 = 0.f;
+	float x1 = 0.f;
+	float x2 = 0.f;
+
+	// Fractional part of the read position, Q0.32. Used by resample_read_phase()
+	uint32_t phase = 0;
+
+	// History of resample_read_phase_int(): raw 16-bit frames as stored in the play buffer.
+	// Stereo keeps L in the low and R in the high halfword (in the left state only),
+	// all other layouts keep one sample in the low halfword.
+	uint32_t fm1 = 0;
+	uint32_t f0 = 0;
+	uint32_t f1 = 0;
+	uint32_t f2 = 0;
+
+	void reset() {
+		phase = 0;
+		xm1 = 0.f;
+		x0 = 0.f;
+		x1 = 0.f;
+		x2 = 0.f;
+		fm1 = 0;
+		f0 = 0;
+		f1 = 0;
+		f2 = 0;
+	}
+};
+
+// Converts a resample rate to a Q32.32 phase increment
+inline uint64_t phase_step(float rs) {
+	if (rs <= 0.f)
+		return 0;
+	uint32_t whole = (uint32_t)rs;
+	uint32_t frac = (uint32_t)((rs - (float)whole) * 4294967296.f);
+	return ((uint64_t)whole << 32) | frac;
+}
+
+// History of the float phase kernels.
+// x0 is the frame at the current integer read position, buf->out points to x2.
+// Stereo reads interleaved frames into both states, all other Chan values use only the left state.
+template<WavChan Chan, PlayFormat F = PlayFormat::S16>
+struct PhaseHistory {
+	static constexpr bool Stereo = Chan == WavChan::Stereo;
+	static constexpr uint32_t BlockAlign = frame_bytes<Chan, F>;
+	static constexpr uint32_t HistorySize = 4;
+
+	CircularBuffer *buf;
+	bool rev;
+	ResamplerState &left;
+	ResamplerState &right;
+
+	void read_next(float &l, float &r) {
+		inc_play_addr<BlockAlign>(buf, rev);
+		if constexpr (Stereo) {
+			auto f = get_stereo_frame<F>(buf);
+			l = f.l;
+			r = f.r;
+		} else
+			l = get_sample<Chan, F>(buf);
+	}
+
+	// Shift the history back one frame and read a new frame into x2
+	void shift_in_next() {
+		left.xm1 = left.x0;
+		left.x0 = left.x1;
+		left.x1 = left.x2;
+		if constexpr (Stereo) {
+			right.xm1 = right.x0;
+			right.x0 = right.x1;
+			right.x1 = right.x2;
+		}
+		read_next(left.x2, right.x2);
+	}
+
+	// Advance the read position by adv whole frames
+	void advance(uint32_t adv) {
+		if (adv >= HistorySize) {
+			// Skip the frames that would be shifted out anyway, then load a full new history
+			offset_play_addr<BlockAlign>(buf, adv - HistorySize, rev);
+			read_next(left.xm1, right.xm1);
+			read_next(left.x0, right.x0);
+			read_next(left.x1, right.x1);
+			read_next(left.x2, right.x2);
+		} else {
+			for (uint32_t i = 0; i < adv; i++)
+				shift_in_next();
+		}
+	}
+
+	// Start over at the frame after buf->out
+	void prime() {
+		read_next(left.x0, right.x0);
+		read_next(left.x1, right.x1);
+		read_next(left.x2, right.x2);
+		left.xm1 = left.x0;
+		right.xm1 = right.x0;
+		left.phase = 0;
+	}
+
+	// Unity rate, on a frame boundary: copy the frames directly, then rebuild the history.
+	// Requires buff_len >= HistorySize
+	void copy_frames(int32_t *oL, int32_t *oR, uint32_t buff_len) {
+		oL[0] = left.x0;
+		oL[1] = left.x1;
+		oL[2] = left.x2;
+		if constexpr (Stereo) {
+			oR[0] = right.x0;
+			oR[1] = right.x1;
+			oR[2] = right.x2;
+		}
+		for (uint32_t outpos = 3; outpos < buff_len; outpos++) {
 			inc_play_addr<BlockAlign>(buf, rev);
-			out[outpos] = get_sample<Chan>(buf->out);
+			if constexpr (Stereo) {
+				auto f = get_stereo_frame<F>(buf);
+				oL[outpos] = f.l;
+				oR[outpos] = f.r;
+			} else
+				oL[outpos] = get_sample<Chan, F>(buf);
 		}
-		x0 = out[buff_len - 3];
-		x1 = out[buff_len - 2];
-		x2 = out[buff_len - 1];
+		left.xm1 = oL[buff_len - 1];
+		if constexpr (Stereo)
+			right.xm1 = oR[buff_len - 1];
+		read_next(left.x0, right.x0);
+		read_next(left.x1, right.x1);
+		read_next(left.x2, right.x2);
+	}
+};
+
+// Resampler driven by a Q32.32 phase accumulator.
+//
+// The integer part of the phase is added to the play address in one wrap-aware step,
+// so the cost per output frame does not depend on the resample rate, and the read
+// position after N frames is exact (no float accumulation error over long loops).
+//
+// Chan == WavChan::Stereo reads interleaved frames into outL/outR using both states,
+// all other Chan values write outL using only the left state.
+template<WavChan Chan, PlayFormat F = PlayFormat::S16>
+void resample_read_phase(uint64_t step,
+						 CircularBuffer *buf,
+						 std::span<int32_t> outL,
+						 std::span<int32_t> outR,
+						 bool rev,
+						 bool flush,
+						 ResamplerState &left,
+						 ResamplerState &right) {
+	using History = PhaseHistory<Chan, F>;
+	constexpr bool Stereo = History::Stereo;
+	History hist{buf, rev, left, right};
+
+	uint32_t buff_len = outL.size();
+	int32_t *oL = outL.data();
+	int32_t *oR = outR.data();
+	uint32_t &phase = left.phase;
+
+	if (flush)
+		hist.prime();
+
+	if (step == (1ULL << 32) && phase == 0 && buff_len >= History::HistorySize) {
+		hist.copy_frames(oL, oR, buff_len);
 		return;
 	}
 
-	// fill the resampling buffer with three points
-	if (flush) {
-		inc_play_addr<BlockAlign>(buf, rev);
-		x0 = get_sample<Chan>(buf->out);
+	float aL, bL, cL;
+	float aR = 0.f, bR = 0.f, cR = 0.f;
+	auto calc_coefs = [&] {
+		aL = (3 * (left.x0 - left.x1) - left.xm1 + left.x2) / 2;
+		bL = 2 * left.x1 + left.xm1 - (5 * left.x0 + left.x2) / 2;
+		cL = (left.x1 - left.xm1) / 2;
+		if constexpr (Stereo) {
+			aR = (3 * (right.x0 - right.x1) - right.xm1 + right.x2) / 2;
+			bR = 2 * right.x1 + right.xm1 - (5 * right.x0 + right.x2) / 2;
+			cR = (right.x1 - right.xm1) / 2;
+		}
+	};
+	calc_coefs();
+
+	for (uint32_t outpos = 0; outpos < buff_len; outpos++) {
+		// top 24 bits of the phase are plenty for float
+		float t = (float)(phase >> 8) * (1.f / 16777216.f);
+
+		float tL = (((aL * t) + bL) * t + cL) * t + left.x0;
+		oL[outpos] = (int32_t)(std::clamp(tL, -32768.f * 256.f, 32767.f * 256.f));
+		if constexpr (Stereo) {
+			float tR = (((aR * t) + bR) * t + cR) * t + right.x0;
+			oR[outpos] = (int32_t)(std::clamp(tR, -32768.f * 256.f, 32767.f * 256.f));
+		}
 
-		inc_play_addr<BlockAlign>(buf, rev);
-		x1 = get_sample<Chan>(buf->out);
+		uint64_t acc = (uint64_t)phase + step;
+		phase = (uint32_t)acc;
+		uint32_t adv = (uint32_t)(acc >> 32);
+		if (adv) {
+			hist.advance(adv);
+			calc_coefs();
+		}
+	}
+}
 
-		inc_play_addr<BlockAlign>(buf, rev);
-		x2 = get_sample<Chan>(buf->out);
+template<WavChan Chan, PlayFormat F = PlayFormat::S16>
+void resample_read_phase(
+	uint64_t step, CircularBuffer *buf, std::span<int32_t> out, bool rev, bool flush, ResamplerState &state) {
+	static_assert(Chan != WavChan::Stereo, "Use the two-channel overload for stereo");
+	resample_read_phase<Chan, F>(step, buf, out, {}, rev, flush, state, state);
+}
 
-		fractional_pos = 0.0;
+// Evaluates the Hermite polynomial of four outputs at once, with the same arithmetic as resample_read_phase().
+// hist holds {xm1, x0, x1, x2} of each output in turn, t holds the position of each output.
+inline void hermite_x4(const float *hist, const float *t, int32_t *out) {
+#if defined(__ARM_NEON)
+	float32x4x4_t h = vld4q_f32(hist);
+	float32x4_t xm1 = h.val[0];
+	float32x4_t x0 = h.val[1];
+	float32x4_t x1 = h.val[2];
+	float32x4_t x2 = h.val[3];
+	float32x4_t half = vdupq_n_f32(0.5f);
+
+	float32x4_t a = vmulq_f32(vaddq_f32(vsubq_f32(vmulq_n_f32(vsubq_f32(x0, x1), 3.f), xm1), x2), half);
+	float32x4_t b = vsubq_f32(vaddq_f32(vaddq_f32(x1, x1), xm1), vmulq_f32(vmlaq_n_f32(x2, x0, 5.f), half));
+	float32x4_t c = vmulq_f32(vsubq_f32(x1, xm1), half);
+
+	float32x4_t tv = vld1q_f32(t);
+	float32x4_t y = vmlaq_f32(b, a, tv);
+	y = vmlaq_f32(c, y, tv);
+	y = vmlaq_f32(x0, y, tv);
+	y = vminq_f32(vmaxq_f32(y, vdupq_n_f32(-32768.f * 256.f)), vdupq_n_f32(32767.f * 256.f));
+	vst1q_s32(out, vcvtq_s32_f32(y));
+#else
+	for (unsigned i = 0; i < 4; i++) {
+		const float *x = &hist[i * 4];
+		float a = (3 * (x[1] - x[2]) - x[0] + x[3]) / 2;
+		float b = 2 * x[2] + x[0] - (5 * x[1] + x[3]) / 2;
+		float c = (x[2] - x[0]) / 2;
+		float y = (((a * t[i]) + b) * t[i] + c) * t[i] + x[1];
+		out[i] = (int32_t)(std::clamp(y, -32768.f * 256.f, 32767.f * 256.f));
 	}
+#endif
+}
 
-	outpos = 0;
-	while (outpos < buff_len) {
-		// Optimize for resample rates >= 4
-		if (fractional_pos >= 4.f) {
-			fractional_pos = fractional_pos - 4.f;
+// Four-wide version of resample_read_phase(), for targets with NEON.
+// The phase and history are advanced one output at a time exactly as in resample_read_phase(),
+// collecting each output's history and position, then the polynomials of four outputs are evaluated together.
+template<WavChan Chan, PlayFormat F = PlayFormat::S16>
+void resample_read_phase_x4(uint64_t step,
+							CircularBuffer *buf,
+							std::span<int32_t> outL,
+							std::span<int32_t> outR,
+							bool rev,
+							bool flush,
+							ResamplerState &left,
+							ResamplerState &right) {
+	using History = PhaseHistory<Chan, F>;
+	constexpr bool Stereo = History::Stereo;
+	History hist{buf, rev, left, right};
+
+	uint32_t buff_len = outL.size();
+	int32_t *oL = outL.data();
+	int32_t *oR = outR.data();
+	uint32_t &phase = left.phase;
+
+	if (flush)
+		hist.prime();
+
+	if (step == (1ULL << 32) && phase == 0 && buff_len >= History::HistorySize) {
+		hist.copy_frames(oL, oR, buff_len);
+		return;
+	}
 
-			// shift samples back one
-			// and read a new sample
-			inc_play_addr<BlockAlign>(buf, rev);
-			xm1 = get_sample<Chan>(buf->out);
+	for (uint32_t outpos = 0; outpos < buff_len; outpos += 4) {
+		alignas(16) float histL[16];
+		alignas(16) float histR[16];
+		alignas(16) float t[4];
+		alignas(16) int32_t partialL[4];
+		alignas(16) int32_t partialR[4];
+
+		uint32_t num = std::min(buff_len - outpos, 4U);
+		for (uint32_t i = 0; i < 4; i++) {
+			// Unused lanes of a partial group are evaluated on the current history and discarded
+			t[i] = (i < num) ? (float)(phase >> 8) * (1.f / 16777216.f) : 0.f;
+			histL[i * 4 + 0] = left.xm1;
+			histL[i * 4 + 1] = left.x0;
+			histL[i * 4 + 2] = left.x1;
+			histL[i * 4 + 3] = left.x2;
+			if constexpr (Stereo) {
+				histR[i * 4 + 0] = right.xm1;
+				histR[i * 4 + 1] = right.x0;
+				histR[i * 4 + 2] = right.x1;
+				histR[i * 4 + 3] = right.x2;
+			}
+			if (i >= num)
+				continue;
+
+			uint64_t acc = (uint64_t)phase + step;
+			phase = (uint32_t)acc;
+			uint32_t adv = (uint32_t)(acc >> 32);
+			if (adv)
+				hist.advance(adv);
+		}
 
-			inc_play_addr<BlockAlign>(buf, rev);
-			x0 = get_sample<Chan>(buf->out);
+		if (num == 4) {
+			hermite_x4(histL, t, &oL[outpos]);
+			if constexpr (Stereo)
+				hermite_x4(histR, t, &oR[outpos]);
+		} else {
+			hermite_x4(histL, t, partialL);
+			std::copy_n(partialL, num, &oL[outpos]);
+			if constexpr (Stereo) {
+				hermite_x4(histR, t, partialR);
+				std::copy_n(partialR, num, &oR[outpos]);
+			}
+		}
+	}
+}
 
-			inc_play_addr<BlockAlign>(buf, rev);
-			x1 = get_sample<Chan>(buf->out);
+template<WavChan Chan, PlayFormat F = PlayFormat::S16>
+void resample_read_phase_x4(
+	uint64_t step, CircularBuffer *buf, std::span<int32_t> out, bool rev, bool flush, ResamplerState &state) {
+	static_assert(Chan != WavChan::Stereo, "Use the two-channel overload for stereo");
+	resample_read_phase_x4<Chan, F>(step, buf, out, {}, rev, flush, state, state);
+}
 
-			inc_play_addr<BlockAlign>(buf, rev);
-			x2 = get_sample<Chan>(buf->out);
+// Reads one frame as raw 16-bit data for resample_read_phase_int()
+template<WavChan Chan, PlayFormat F = PlayFormat::S16>
+inline uint32_t get_raw_frame(uint32_t addr) {
+	wait_memory_ready();
+
+	if constexpr (F != PlayFormat::S16) {
+		using S = PlayStorage<F>;
+		if constexpr (Chan == WavChan::Left || Chan == WavChan::Mono)
+			return S::load16(addr);
+		else if constexpr (Chan == WavChan::Right)
+			return S::load16(addr + S::Bytes);
+		else if constexpr (Chan == WavChan::Average)
+			return (uint16_t)(((int16_t)S::load16(addr) + (int16_t)S::load16(addr + S::Bytes)) >> 1);
+		else
+			return S::load16(addr) | (S::load16(addr + S::Bytes) << 16);
+	}
+
+	if constexpr (Chan == WavChan::Left || Chan == WavChan::Mono) {
+		return *reinterpret_cast<uint16_t *>(addr);
+
+	} else if constexpr (Chan == WavChan::Right) {
+		return *reinterpret_cast<uint16_t *>(addr + 2);
+
+	} else if constexpr (Chan == WavChan::Average) {
+		uint32_t rd = *reinterpret_cast<uint32_t *>(addr);
+		int32_t t = (int16_t)(rd & 0xFFFF) + (int16_t)(rd >> 16);
+		return (uint16_t)(t >> 1);
+
+	} else {
+		return *reinterpret_cast<uint32_t *>(addr);
+	}
+}
+
+template<WavChan Chan, PlayFormat F>
+inline uint32_t get_raw_frame(CircularBuffer *buf) {
+	if constexpr (F == PlayFormat::Adpcm) {
+		const int16_t *f = buf->adpcm->frame(buf->out);
+		if constexpr (Chan == WavChan::Left || Chan == WavChan::Mono)
+			return (uint16_t)f[0];
+		else if constexpr (Chan == WavChan::Right)
+			return (uint16_t)f[1];
+		else if constexpr (Chan == WavChan::Average)
+			return (uint16_t)(((int32_t)f[0] + f[1]) >> 1);
+		else
+			return (uint16_t)f[0] | ((uint32_t)(uint16_t)f[1] << 16);
+	} else
+		return get_raw_frame<Chan, F>(buf->out);
+}
+
+// Catmull-Rom weights of xm1, x0, x1, x2 at position t (Q16), packed as Q14 pairs {wm1, w0} and {w1, w2}.
+// This is the same curve as the float kernel's a/b/c polynomial, rearranged so that each output
+// is a dot product of the history with the weights.
+struct HermiteWeights {
+	uint32_t w01;
+	uint32_t w23;
+};
+
+inline HermiteWeights hermite_weights_q14(uint32_t t) {
+	int32_t t2 = (t * t + (1u << 15)) >> 16;
+	int32_t t3 = ((uint32_t)t2 * t + (1u << 15)) >> 16;
+	int32_t t1 = t;
+
+	// Each weight is (polynomial in Q16) / 2, so shift by 3 (with rounding) to get Q14
+	int32_t wm1 = (-t3 + 2 * t2 - t1 + 4) >> 3;
+	int32_t w1 = (-3 * t3 + 4 * t2 + t1 + 4) >> 3;
+	int32_t w2 = (t3 - t2 + 4) >> 3;
+	// Derive w0 so that the weights always sum to exactly 1.0 (no DC error)
+	int32_t w0 = (1 << 14) - wm1 - w1 - w2;
+
+	return {Packed16::pack_lo(wm1, w0), Packed16::pack_lo(w1, w2)};
+}
+
+// Integer version of resample_read_phase(): same phase accumulator and history handling,
+// but the history stays as the raw 16-bit words read from the play buffer and each output is
+// two dual 16-bit MACs per channel against Q14 weights. Output is 24-bit, like the float kernel.
+// resample_read_phase() is the reference: outputs match it to within a few LSBs of the 16-bit source.
+// The left state holds the history of both channels, right is unused.
+template<WavChan Chan, PlayFormat F = PlayFormat::S16>
+void resample_read_phase_int(uint64_t step,
+							 CircularBuffer *buf,
+							 std::span<int32_t> outL,
+							 std::span<int32_t> outR,
+							 bool rev,
+							 bool flush,
+							 ResamplerState &left,
+							 [[maybe_unused]] ResamplerState &right) {
+	using namespace Packed16;
+	constexpr bool Stereo = Chan == WavChan::Stereo;
+	constexpr uint32_t BlockAlign = frame_bytes<Chan, F>;
+	constexpr uint32_t HistorySize = 4;
+	static_assert(F != PlayFormat::S24, "The 16-bit integer kernels would drop the low byte of 24-bit samples");
+
+	auto &s = left;
+
+	auto read_next = [buf, rev]() -> uint32_t {
+		inc_play_addr<BlockAlign>(buf, rev);
+		return get_raw_frame<Chan, F>(buf);
+	};
+
+	auto advance = [&](uint32_t adv) {
+		if (adv >= HistorySize) {
+			offset_play_addr<BlockAlign>(buf, adv - HistorySize, rev);
+			s.fm1 = read_next();
+			s.f0 = read_next();
+			s.f1 = read_next();
+			s.f2 = read_next();
+		} else {
+			for (uint32_t i = 0; i < adv; i++) {
+				s.fm1 = s.f0;
+				s.f0 = s.f1;
+				s.f1 = s.f2;
+				s.f2 = read_next();
+			}
 		}
-		// Optimize for resample rates >= 3
-		if (fractional_pos >= 3.f) {
-			fractional_pos = fractional_pos - 3.f;
+	};
 
-			// shift samples back one
-			// and read a new sample
-			xm1 = x2;
+	// Convert a raw halfword to 24-bit
+	auto to24 = [](uint32_t halfword) { return (int32_t)(int16_t)halfword * 256; };
 
-			inc_play_addr<BlockAlign>(buf, rev);
-			x0 = get_sample<Chan>(buf->out);
+	uint32_t buff_len = outL.size();
+	int32_t *oL = outL.data();
+	int32_t *oR = outR.data();
+	uint32_t &phase = s.phase;
 
-			inc_play_addr<BlockAlign>(buf, rev);
-			x1 = get_sample<Chan>(buf->out);
+	if (flush) {
+		s.f0 = read_next();
+		s.f1 = read_next();
+		s.f2 = read_next();
+		s.fm1 = s.f0;
+		phase = 0;
+	}
 
-			inc_play_addr<BlockAlign>(buf, rev);
-			x2 = get_sample<Chan>(buf->out);
+	// Unity rate, on a frame boundary: copy the frames directly, then rebuild the history
+	if (step == (1ULL << 32) && phase == 0 && buff_len >= HistorySize) {
+		const uint32_t first[3] = {s.f0, s.f1, s.f2};
+		uint32_t f = 0;
+		for (uint32_t outpos = 0; outpos < buff_len; outpos++) {
+			f = (outpos < 3) ? first[outpos] : read_next();
+			oL[outpos] = to24(f);
+			if constexpr (Stereo)
+				oR[outpos] = to24(f >> 16);
 		}
-		// Optimize for resample rates >= 2
-		if (fractional_pos >= 2.f) {
-			fractional_pos = fractional_pos - 2.f;
+		s.fm1 = f;
+		s.f0 = read_next();
+		s.f1 = read_next();
+		s.f2 = read_next();
+		return;
+	}
 
-			// shift samples back one
-			// and read a new sample
-			xm1 = x1;
-			x0 = x2;
+	// Per-channel history pairs {xm1, x0} and {x1, x2}
+	uint32_t L01, L23, R01 = 0, R23 = 0;
+	auto pack_history = [&] {
+		L01 = pack_lo(s.fm1, s.f0);
+		L23 = pack_lo(s.f1, s.f2);
+		if constexpr (Stereo) {
+			R01 = pack_hi(s.fm1, s.f0);
+			R23 = pack_hi(s.f1, s.f2);
+		}
+	};
+	pack_history();
+
+	for (uint32_t outpos = 0; outpos < buff_len; outpos++) {
+		auto w = hermite_weights_q14(phase >> 16);
+
+		// Q14 weights * 16-bit samples: shift by 6 to get 24-bit
+		oL[outpos] = ssat24(smlad(L23, w.w23, smlad(L01, w.w01, 0)) >> 6);
+		if constexpr (Stereo)
+			oR[outpos] = ssat24(smlad(R23, w.w23, smlad(R01, w.w01, 0)) >> 6);
+
+		uint64_t acc = (uint64_t)phase + step;
+		phase = (uint32_t)acc;
+		uint32_t adv = (uint32_t)(acc >> 32);
+		if (adv) {
+			advance(adv);
+			pack_history();
+		}
+	}
+}
 
-			inc_play_addr<BlockAlign>(buf, rev);
-			x1 = get_sample<Chan>(buf->out);
+template<WavChan Chan, PlayFormat F = PlayFormat::S16>
+void resample_read_phase_int(
+	uint64_t step, CircularBuffer *buf, std::span<int32_t> out, bool rev, bool flush, ResamplerState &state) {
+	static_assert(Chan != WavChan::Stereo, "Use the two-channel overload for stereo");
+	resample_read_phase_int<Chan, F>(step, buf, out, {}, rev, flush, state, state);
+}
 
-			inc_play_addr<BlockAlign>(buf, rev);
-			x2 = get_sample<Chan>(buf->out);
+// Ratio of a sample's rate to the codec rate, as a reduced fraction (147/160 for 44.1k on 48k)
+// and as a float for the generic kernels. Computed once per stream, not per block.
+struct RateRatio {
+	uint32_t num = 1;
+	uint32_t den = 1;
+	float ratio = 1.f;
+
+	static constexpr RateRatio make(uint32_t sample_rate, uint32_t out_rate) {
+		if (sample_rate == 0 || out_rate == 0)
+			return {};
+		uint32_t a = sample_rate, b = out_rate;
+		while (b) {
+			uint32_t t = a % b;
+			a = b;
+			b = t;
 		}
-		// Optimize for resample rates >= 1
-		if (fractional_pos >= 1.f) {
-			fractional_pos = fractional_pos - 1.f;
+		return {sample_rate / a, out_rate / a, (float)sample_rate / (float)out_rate};
+	}
+};
+
+// Hermite weights of each phase of a rational rate: entry k is for position k / den.
+// Built once when the rate changes, so the rational kernel only does table lookups.
+struct RationalHermiteTable {
+	// 147/320 (22.05k on 48k) is the largest denominator of the common rates
+	static constexpr uint32_t MaxPhases = 320;
+
+	uint32_t num = 1;
+	uint32_t den = 1;
+	std::array<HermiteWeights, MaxPhases> weights{};
+
+	static constexpr bool supports(RateRatio r) { return r.den <= MaxPhases && !(r.num == 1 && r.den == 1); }
+
+	void build(RateRatio r) {
+		if (r.num == num && r.den == den)
+			return;
+		num = r.num;
+		den = r.den;
+		for (uint32_t k = 0; k < den; k++)
+			weights[k] = hermite_weights_q14((k << 16) / den);
+	}
+};
+
+// resample_read_phase_int() for an exact rational rate table.num / table.den.
+// The position advances by whole input frames and an integer phase 0..den-1, so there is no rounding
+// in the step and no drift, and the weights come from the table.
+// The history and the Q0.32 phase in the state are shared with resample_read_phase_int(), so a stream
+// can switch between the two kernels on any block (the phase snaps to the nearest 1/den, which is
+// far below audibility).
+template<WavChan Chan, PlayFormat F = PlayFormat::S16>
+void resample_read_rational_int(const RationalHermiteTable &table,
+								CircularBuffer *buf,
+								std::span<int32_t> outL,
+								std::span<int32_t> outR,
+								bool rev,
+								bool flush,
+								ResamplerState &left,
+								[[maybe_unused]] ResamplerState &right) {
+	using namespace Packed16;
+	constexpr bool Stereo = Chan == WavChan::Stereo;
+	constexpr uint32_t BlockAlign = frame_bytes<Chan, F>;
+	constexpr uint32_t HistorySize = 4;
+	static_assert(F != PlayFormat::S24, "The 16-bit integer kernels would drop the low byte of 24-bit samples");
+
+	auto &s = left;
+	const uint32_t den = table.den;
+	const uint32_t whole_step = table.num / den;
+	const uint32_t frac_step = table.num % den;
+
+	auto read_next = [buf, rev]() -> uint32_t {
+		inc_play_addr<BlockAlign>(buf, rev);
+		return get_raw_frame<Chan, F>(buf);
+	};
 
-			// shift samples back one
-			// and read a new sample
-			xm1 = x0;
-			x0 = x1;
-			x1 = x2;
+	if (flush) {
+		s.f0 = read_next();
+		s.f1 = read_next();
+		s.f2 = read_next();
+		s.fm1 = s.f0;
+		s.phase = 0;
+	}
 
-			inc_play_addr<BlockAlign>(buf, rev);
-			x2 = get_sample<Chan>(buf->out);
+	// Q0.32 phase to the nearest k / den. The phase stored at the end of the block converts back to the same k
+	uint32_t k = (uint32_t)(((uint64_t)s.phase * den + (1ULL << 31)) >> 32);
+	uint32_t adv_carry = 0;
+	if (k == den) {
+		k = 0;
+		adv_carry = 1;
+	}
+
+	uint32_t L01, L23, R01 = 0, R23 = 0;
+	auto pack_history = [&] {
+		L01 = pack_lo(s.fm1, s.f0);
+		L23 = pack_lo(s.f1, s.f2);
+		if constexpr (Stereo) {
+			R01 = pack_hi(s.fm1, s.f0);
+			R23 = pack_hi(s.f1, s.f2);
+		}
+	};
+
+	auto advance = [&](uint32_t adv) {
+		if (adv >= HistorySize) {
+			offset_play_addr<BlockAlign>(buf, adv - HistorySize, rev);
+			s.fm1 = read_next();
+			s.f0 = read_next();
+			s.f1 = read_next();
+			s.f2 = read_next();
+		} else {
+			for (uint32_t i = 0; i < adv; i++) {
+				s.fm1 = s.f0;
+				s.f0 = s.f1;
+				s.f1 = s.f2;
+				s.f2 = read_next();
+			}
+		}
+	};
+
+	if (adv_carry)
+		advance(adv_carry);
+	pack_history();
+
+	uint32_t buff_len = outL.size();
+	int32_t *oL = outL.data();
+	int32_t *oR = outR.data();
+
+	for (uint32_t outpos = 0; outpos < buff_len; outpos++) {
+		auto w = table.weights[k];
+		oL[outpos] = ssat24(smlad(L23, w.w23, smlad(L01, w.w01, 0)) >> 6);
+		if constexpr (Stereo)
+			oR[outpos] = ssat24(smlad(R23, w.w23, smlad(R01, w.w01, 0)) >> 6);
+
+		uint32_t adv = whole_step;
+		k += frac_step;
+		if (k >= den) {
+			k -= den;
+			adv++;
+		}
+		if (adv) {
+			advance(adv);
+			pack_history();
 		}
+	}
+
+	s.phase = (uint32_t)(((uint64_t)k << 32) / den);
+}
 
-		// calculate coefficients
-		a = (3 * (x0 - x1) - xm1 + x2) / 2;
-		b = 2 * x1 + xm1 - (5 * x0 + x2) / 2;
-		c = (x1 - xm1) / 2;
+template<WavChan Chan, PlayFormat F = PlayFormat::S16>
+void resample_read_rational_int(const RationalHermiteTable &table,
+								CircularBuffer *buf,
+								std::span<int32_t> out,
+								bool rev,
+								bool flush,
+								ResamplerState &state) {
+	static_assert(Chan != WavChan::Stereo, "Use the two-channel overload for stereo");
+	resample_read_rational_int<Chan, F>(table, buf, out, {}, rev, flush, state, state);
+}
+
+// resample_read_phase_x4() for an exact rational rate table.num / table.den, for targets with NEON.
+// The position steps exactly as in resample_read_rational_int(), and each output is evaluated at k / den with
+// the float polynomial (the table's integer weights are not used).
+// The float history and the Q0.32 phase in the state are shared with resample_read_phase_x4(), so a stream
+// can switch between the two kernels on any block.
+template<WavChan Chan, PlayFormat F = PlayFormat::S16>
+void resample_read_rational_x4(const RationalHermiteTable &table,
+							   CircularBuffer *buf,
+							   std::span<int32_t> outL,
+							   std::span<int32_t> outR,
+							   bool rev,
+							   bool flush,
+							   ResamplerState &left,
+							   ResamplerState &right) {
+	using History = PhaseHistory<Chan, F>;
+	constexpr bool Stereo = History::Stereo;
+	History hist{buf, rev, left, right};
+
+	const uint32_t den = table.den;
+	const uint32_t whole_step = table.num / den;
+	const uint32_t frac_step = table.num % den;
+	const float inv_den = 1.f / (float)den;
+
+	if (flush)
+		hist.prime();
+
+	// Q0.32 phase to the nearest k / den, as in resample_read_rational_int()
+	uint32_t k = (uint32_t)(((uint64_t)left.phase * den + (1ULL << 31)) >> 32);
+	if (k == den) {
+		k = 0;
+		hist.advance(1);
+	}
 
-		// calculate as many fractionally placed output points as we need
-		while (fractional_pos < 1.f && outpos < buff_len) {
-			t_out = (((a * fractional_pos) + b) * fractional_pos + c) * fractional_pos + x0;
-			out[outpos++] = (int32_t)(std::clamp(t_out, -32768.f * 256.f, 32767.f * 256.f));
+	uint32_t buff_len = outL.size();
+	int32_t *oL = outL.data();
+	int32_t *oR = outR.data();
+
+	for (uint32_t outpos = 0; outpos < buff_len; outpos += 4) {
+		alignas(16) float histL[16];
+		alignas(16) float histR[16];
+		alignas(16) float t[4];
+		alignas(16) int32_t partialL[4];
+		alignas(16) int32_t partialR[4];
+
+		uint32_t num = std::min(buff_len - outpos, 4U);
+		for (uint32_t i = 0; i < 4; i++) {
+			t[i] = (i < num) ? (float)k * inv_den : 0.f;
+			histL[i * 4 + 0] = left.xm1;
+			histL[i * 4 + 1] = left.x0;
+			histL[i * 4 + 2] = left.x1;
+			histL[i * 4 + 3] = left.x2;
+			if constexpr (Stereo) {
+				histR[i * 4 + 0] = right.xm1;
+				histR[i * 4 + 1] = right.x0;
+				histR[i * 4 + 2] = right.x1;
+				histR[i * 4 + 3] = right.x2;
+			}
+			if (i >= num)
+				continue;
+
+			uint32_t adv = whole_step;
+			k += frac_step;
+			if (k >= den) {
+				k -= den;
+				adv++;
+			}
+			if (adv)
+				hist.advance(adv);
+		}
 
-			fractional_pos += rs;
+		if (num == 4) {
+			hermite_x4(histL, t, &oL[outpos]);
+			if constexpr (Stereo)
+				hermite_x4(histR, t, &oR[outpos]);
+		} else {
+			hermite_x4(histL, t, partialL);
+			std::copy_n(partialL, num, &oL[outpos]);
+			if constexpr (Stereo) {
+				hermite_x4(histR, t, partialR);
+				std::copy_n(partialR, num, &oR[outpos]);
+			}
 		}
 	}
+
+	left.phase = (uint32_t)(((uint64_t)k << 32) / den);
+}
+
+template<WavChan Chan, PlayFormat F = PlayFormat::S16>
+void resample_read_rational_x4(const RationalHermiteTable &table,
+							   CircularBuffer *buf,
+							   std::span<int32_t> out,
+							   bool rev,
+							   bool flush,
+							   ResamplerState &state) {
+	static_assert(Chan != WavChan::Stereo, "Use the two-channel overload for stereo");
+	resample_read_rational_x4<Chan, F>(table, buf, out, {}, rev, flush, state, state);
 }
 
 } // namespace SamplerKit
@@ -0,0 +1,219 @@
+#pragma once
+#include "resample.hh"
+#include <array>
+#include <bit>
+#include <cstdint>
+
+namespace SamplerKit
+{
+
+// Math for generating coefficient tables at compile time (std:: math functions are not constexpr)
+namespace ConstexprMath
+{
+constexpr double Pi = 3.14159265358979323846;
+
+constexpr double sin(double x) {
+	while (x > Pi)
+		x -= 2 * Pi;
+	while (x < -Pi)
+		x += 2 * Pi;
+	double term = x;
+	double sum = x;
+	for (int n = 1; n < 20; n++) {
+		term *= -x * x / ((2 * n) * (2 * n + 1));
+		sum += term;
+	}
+	return sum;
+}
+
+constexpr double sqrt(double x) {
+	if (x <= 0)
+		return 0;
+	double r = x > 1 ? x : 1;
+	for (int i = 0; i < 60; i++)
+		r = (r + x / r) / 2;
+	return r;
+}
+
+// Modified Bessel function of the first kind, order 0
+constexpr double bessel_i0(double x) {
+	double term = 1;
+	double sum = 1;
+	for (int k = 1; k < 40; k++) {
+		term *= (x / (2 * k)) * (x / (2 * k));
+		sum += term;
+	}
+	return sum;
+}
+
+constexpr double sinc(double x) {
+	return (x == 0) ? 1 : sin(Pi * x) / (Pi * x);
+}
+} // namespace ConstexprMath
+
+// Kaiser-windowed sinc lowpass, in polyphase form.
+// Row p holds the Taps coefficients for an output at fractional position p / Phases past the center tap,
+// and delta[p] = coef[p + 1] - coef[p], so the coefficients can be linearly interpolated between rows.
+// Each row is normalized to unity DC gain.
+template<unsigned Taps, unsigned Phases>
+struct SincTable {
+	static_assert(Taps % 2 == 0, "Tap count must be even");
+
+	// Cutoff as a fraction of the input Nyquist frequency, and Kaiser window shape.
+	// Shorter filters get a lower cutoff to keep the transition band above Nyquist narrow enough
+	static constexpr double Cutoff = Taps >= 32 ? 0.92 : Taps >= 16 ? 0.88 : 0.80;
+	static constexpr double Beta = Taps >= 32 ? 8.6 : Taps >= 16 ? 7.0 : 5.0;
+
+	std::array<std::array<float, Taps>, Phases> coef{};
+	std::array<std::array<float, Taps>, Phases> delta{};
+
+	constexpr SincTable() {
+		std::array<std::array<double, Taps>, Phases + 1> h{};
+		constexpr double half = Taps / 2;
+
+		for (unsigned p = 0; p <= Phases; p++) {
+			double sum = 0;
+			for (unsigned k = 0; k < Taps; k++) {
+				// Distance from tap k to the output position
+				double x = (double)k - (half - 1) - (double)p / Phases;
+				double w = x / half;
+				double window = (w * w < 1) ? ConstexprMath::bessel_i0(Beta * ConstexprMath::sqrt(1 - w * w)) /
+												  ConstexprMath::bessel_i0(Beta) :
+												  0;
+				h[p][k] = ConstexprMath::sinc(Cutoff * x) * window;
+				sum += h[p][k];
+			}
+			for (auto &c : h[p])
+				c /= sum;
+		}
+
+		for (unsigned p = 0; p < Phases; p++) {
+			for (unsigned k = 0; k < Taps; k++) {
+				coef[p][k] = (float)h[p][k];
+				delta[p][k] = (float)(h[p + 1][k] - h[p][k]);
+			}
+		}
+	}
+};
+
+// One table per tap count, shared by all streams, and placed in flash
+template<unsigned Taps>
+inline constexpr SincTable<Taps, 64> sinc_table{};
+
+// History of one stream for the windowed-sinc kernel.
+// Each channel's last Taps frames are kept in a ring that is written twice, Taps apart,
+// so the frames are always contiguous starting at hist[pos] and no wrapping is needed in the filter loop.
+// The newest frame is at buf->out, the center of the filter (x0 of the Hermite kernels) is Taps/2 - 1 frames before it.
+template<unsigned Taps>
+struct SincState {
+	float left[Taps * 2]{};
+	float right[Taps * 2]{};
+	uint32_t pos = 0;
+
+	// Fractional part of the read position, Q0.32
+	uint32_t phase = 0;
+
+	void reset() { *this = SincState{}; }
+
+	void push(float l, float r) {
+		left[pos] = l;
+		left[pos + Taps] = l;
+		right[pos] = r;
+		right[pos + Taps] = r;
+		pos = (pos + 1) % Taps;
+	}
+};
+
+// High quality resampler: polyphase windowed-sinc FIR with Taps taps, driven by a Q32.32 phase accumulator
+// like resample_read_phase().
+//
+// Images are rejected properly when pitching down (rs < 1), and the 44.1k to 48k conversion is clean.
+// When pitching up the cutoff stays at the sample's Nyquist frequency, so like the Hermite kernels
+// it does not band-limit to the output rate (octave sidecars take care of that at high pitches).
+template<WavChan Chan, unsigned Taps, PlayFormat F = PlayFormat::S16>
+void resample_read_sinc(uint64_t step,
+						CircularBuffer *buf,
+						std::span<int32_t> outL,
+						std::span<int32_t> outR,
+						bool rev,
+						bool flush,
+						SincState<Taps> &state) {
+	constexpr bool Stereo = Chan == WavChan::Stereo;
+	constexpr uint32_t BlockAlign = frame_bytes<Chan, F>;
+	constexpr auto &table = sinc_table<Taps>;
+	constexpr unsigned Phases = table.coef.size();
+	constexpr unsigned PhaseBits = std::countr_zero(Phases);
+	static_assert(std::has_single_bit(Phases));
+
+	auto read_next = [&] {
+		inc_play_addr<BlockAlign>(buf, rev);
+		if constexpr (Stereo) {
+			auto f = get_stereo_frame<F>(buf);
+			state.push(f.l, f.r);
+		} else
+			state.push(get_sample<Chan, F>(buf), 0.f);
+	};
+
+	if (flush) {
+		// Start with the center at the frame after buf->out, and repeat that frame back through the older history
+		state.reset();
+		inc_play_addr<BlockAlign>(buf, rev);
+		float l, r = 0.f;
+		if constexpr (Stereo) {
+			auto f = get_stereo_frame<F>(buf);
+			l = f.l;
+			r = f.r;
+		} else
+			l = get_sample<Chan, F>(buf);
+		for (unsigned i = 0; i < Taps / 2; i++)
+			state.push(l, r);
+		for (unsigned i = 0; i < Taps / 2; i++)
+			read_next();
+	}
+
+	uint32_t buff_len = outL.size();
+	for (uint32_t outpos = 0; outpos < buff_len; outpos++) {
+		uint32_t row = state.phase >> (32 - PhaseBits);
+		float frac = (float)((state.phase << PhaseBits) >> 8) * (1.f / 16777216.f);
+		const float *c = table.coef[row].data();
+		const float *d = table.delta[row].data();
+
+		const float *hL = &state.left[state.pos];
+		float accL = 0.f, daccL = 0.f;
+		for (unsigned k = 0; k < Taps; k++) {
+			accL += c[k] * hL[k];
+			daccL += d[k] * hL[k];
+		}
+		outL[outpos] = (int32_t)(std::clamp(accL + frac * daccL, -32768.f * 256.f, 32767.f * 256.f));
+
+		if constexpr (Stereo) {
+			const float *hR = &state.right[state.pos];
+			float accR = 0.f, daccR = 0.f;
+			for (unsigned k = 0; k < Taps; k++) {
+				accR += c[k] * hR[k];
+				daccR += d[k] * hR[k];
+			}
+			outR[outpos] = (int32_t)(std::clamp(accR + frac * daccR, -32768.f * 256.f, 32767.f * 256.f));
+		}
+
+		uint64_t acc = (uint64_t)state.phase + step;
+		state.phase = (uint32_t)acc;
+		uint32_t adv = (uint32_t)(acc >> 32);
+		if (adv >= Taps) {
+			// Skip the frames that would be shifted out anyway
+			offset_play_addr<BlockAlign>(buf, adv - Taps, rev);
+			adv = Taps;
+		}
+		for (uint32_t i = 0; i < adv; i++)
+			read_next();
+	}
+}
+
+template<WavChan Chan, unsigned Taps, PlayFormat F = PlayFormat::S16>
+void resample_read_sinc(
+	uint64_t step, CircularBuffer *buf, std::span<int32_t> out, bool rev, bool flush, SincState<Taps> &state) {
+	static_assert(Chan != WavChan::Stereo, "Use the two-channel overload for stereo");
+	resample_read_sinc<Chan, Taps, F>(step, buf, out, {}, rev, flush, state);
+}
+
+} // namespace SamplerKit
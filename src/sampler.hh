@@ -1,4 +1,5 @@
 #pragma once
+#include "octave_sidecar_builder.hh"
 #include "sampler_audio.hh"
 #include "sampler_loader.hh"
 #include "sampler_modes.hh"
@@ -14,13 +15,17 @@ struct Sampler {
 	Sampler(Params &params, Flags &flags, Sdcard &sd, BankManager &banks)
 		: audio{modes, params, flags, banks.samples, play_buff}
 		, loader{modes, params, flags, sd, banks, play_buff, g_error}
-		, modes{params, flags, sd, banks, recorder, play_buff, g_error}
-		, recorder{params, flags, sd, banks} {}
+		, modes{params, flags, sd, banks, recorder, sidecars, play_buff, g_error}
+		, recorder{params, flags, sd, banks}
+		, sidecars{sd, banks.samples, params}
+		, params{params} {}
 
 	SamplerAudio audio;
 	SampleLoader loader;
 	SamplerModes modes;
 	Recorder recorder;
+	OctaveSidecarBuilder sidecars;
+	Params &params;
 
 	void start() { loader.start(); }
 
@@ -28,6 +33,11 @@ struct Sampler {
 		modes.process_mode_flags();
 		loader.update();
 		recorder.write_buffer_to_storage();
+
+		// Build sidecars only when the SD card has nothing else to do: each step reads a chunk and writes up
+		// to three files, and the write latency would hold up streaming or recording
+		if (params.settings.octave_sidecars && params.rec_state == RecStates::REC_OFF && loader.idle())
+			sidecars.update();
 	}
 };
 
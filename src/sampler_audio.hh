@@ -1,8 +1,11 @@
 #pragma once
 #include "audio_stream_conf.hh"
 #include "circular_buffer.hh"
+#include "conf/resample_conf.hh"
+#include "mix_kernels.hh"
 #include "params.hh"
 #include "resample.hh"
+#include "resample_sinc.hh"
 #include "sampler_calcs.hh"
 #include "util/zip.hh"
 
@@ -20,6 +23,77 @@ class SamplerAudio {
 
 	using ChanBuff = std::array<AudioStreamConf::SampleT, AudioStreamConf::BlockSize>;
 
+	// The output block as interleaved samples, for the mix kernels
+	static std::span<int32_t> interleaved(AudioStreamConf::AudioOutBlock &outblock) {
+		static_assert(sizeof(AudioStreamConf::AudioOutFrame) == sizeof(int32_t) * AudioStreamConf::NumOutChans);
+		return {&outblock[0].chan[0], outblock.size() * AudioStreamConf::NumOutChans};
+	}
+
+	// Interpolation state of each playback stream (one stream per sample slot)
+	struct StreamResampler {
+		ResamplerState left;
+		ResamplerState right;
+		SincState<ResampleConf::SincTaps> sinc;
+		WavChan last_chan = WavChan::Mono;
+		ResampleQuality last_quality = ResampleQuality::Standard;
+	};
+	std::array<StreamResampler, NumSamplesPerBank> resampler;
+
+	// Rate and weights for the rational kernels. Only the slot that is playing uses it
+	RationalHermiteTable rational_table;
+
+	// Runs the windowed-sinc kernel in High quality, otherwise the Hermite kernel chosen for this target in
+	// conf/resample_conf.hh (at the exact rational_table rate if rational is set). outR is only written for
+	// WavChan::Stereo. Packed 24-bit always uses the float Hermite kernel, since the integer kernels are 16-bit
+	template<WavChan Chan, PlayFormat F>
+	void resample(StreamResampler &stream,
+				  uint64_t step,
+				  bool rational,
+				  CircularBuffer *buf,
+				  std::span<int32_t> outL,
+				  std::span<int32_t> outR,
+				  bool flush) {
+		bool rev = params.reverse;
+		if (params.settings.resample_quality == ResampleQuality::High)
+			resample_read_sinc<Chan, ResampleConf::SincTaps, F>(step, buf, outL, outR, rev, flush, stream.sinc);
+		else if constexpr (F == PlayFormat::S24)
+			resample_read_phase<Chan, F>(step, buf, outL, outR, rev, flush, stream.left, stream.right);
+		else if (ResampleConf::RationalKernel && rational) {
+			// Each shares its history with the Hermite kernel of this target
+			if constexpr (ResampleConf::VectorKernel)
+				resample_read_rational_x4<Chan, F>(
+					rational_table, buf, outL, outR, rev, flush, stream.left, stream.right);
+			else
+				resample_read_rational_int<Chan, F>(
+					rational_table, buf, outL, outR, rev, flush, stream.left, stream.right);
+		} else if constexpr (ResampleConf::IntegerKernel)
+			resample_read_phase_int<Chan, F>(step, buf, outL, outR, rev, flush, stream.left, stream.right);
+		else if constexpr (ResampleConf::VectorKernel)
+			resample_read_phase_x4<Chan, F>(step, buf, outL, outR, rev, flush, stream.left, stream.right);
+		else
+			resample_read_phase<Chan, F>(step, buf, outL, outR, rev, flush, stream.left, stream.right);
+	}
+
+	// Selects the kernels for the play buffer format of the stream
+	template<WavChan Chan>
+	void resample(StreamResampler &stream,
+				  PlayFormat format,
+				  uint64_t step,
+				  bool rational,
+				  CircularBuffer *buf,
+				  std::span<int32_t> outL,
+				  std::span<int32_t> outR,
+				  bool flush) {
+		if (format == PlayFormat::S8)
+			resample<Chan, PlayFormat::S8>(stream, step, rational, buf, outL, outR, flush);
+		else if (format == PlayFormat::S24)
+			resample<Chan, PlayFormat::S24>(stream, step, rational, buf, outL, outR, flush);
+		else if (format == PlayFormat::Adpcm)
+			resample<Chan, PlayFormat::Adpcm>(stream, step, rational, buf, outL, outR, flush);
+		else
+			resample<Chan, PlayFormat::S16>(stream, step, rational, buf, outL, outR, flush);
+	}
+
 public:
 	float env_level;
 	float env_rate = 0.f;
@@ -58,25 +132,15 @@ public:
 			// Left Out = Left Sample channel
 			// Right Out = Right Sample channel
 			//
-			for (auto [out, L, R] : zip(outblock, outL, outR)) {
-				// Chan 1 L + Chan 2 L clipped at signed 16-bits
-				int32_t invL = -L;
-				int32_t invR = -R;
-				out.chan[1] = __SSAT(invL, 24);
-				out.chan[0] = __SSAT(invR, 24);
-			}
+			write_stereo_out(interleaved(outblock), outL, outR);
 			return;
 		}
 
 		{
 			// Mono mode
 			// Left Out = -Right Out = average of L+R
-			for (auto [out, L, R] : zip(outblock, outL, outR)) {
-				// Average is already done in play_audio_from_buffer(), and put into outL
-				int32_t invL = -L;
-				out.chan[1] = __SSAT(invL, 24);
-				out.chan[0] = __SSAT(L, 24);
-			}
+			// Average is already done in play_audio_from_buffer(), and put into outL
+			write_mono_out(interleaved(outblock), outL);
 		}
 	}
 
@@ -94,87 +158,77 @@ public:
 		// Calculate our actual resampling rate, based on the sample rate of the file being played
 		uint8_t samplenum = params.sample_num_now_playing;
 		uint8_t banknum = params.sample_bank_now_playing;
-		Sample &s_sample = samples[banknum][samplenum];
+		Sample &s_sample = sampler_modes.stream_sample(banknum, samplenum);
 
-		float rs = (s_sample.sampleRate == params.settings.record_sample_rate) ?
-					   params.pitch :
-					   params.pitch * ((float)s_sample.sampleRate / (float)params.settings.record_sample_rate);
+		float rs = sampler_modes.stream_rs(samplenum);
+
+		// Untransposed playback of a sample at another rate (e.g. 44.1k) uses the exact rational rate
+		const RateRatio &rate = sampler_modes.stream_rate[samplenum];
+		bool rational = ResampleConf::RationalKernel && params.unity_pitch && RationalHermiteTable::supports(rate);
+		if (rational)
+			rational_table.build(rate);
 
 		sampler_modes.check_sample_end();
 
+		auto &stream = resampler[samplenum];
+		auto &buf = play_buff[samplenum];
 		bool flush = flags.read(Flag::PlayBuffDiscontinuity);
+
+		// The history belongs to one channel layout: re-prime it if the layout changed
+		// (stereo mode toggled, or a different sample was loaded into this slot)
+		const WavChan chan = params.settings.stereo_mode ?
+								 (s_sample.numChannels == 2 ? WavChan::Left : WavChan::Mono) :
+								 (s_sample.numChannels == 2 ? WavChan::Average : WavChan::Mono);
+		if (chan != stream.last_chan) {
+			stream.last_chan = chan;
+			flush = true;
+		}
+		// Each kernel has its own history
+		if (params.settings.resample_quality != stream.last_quality) {
+			stream.last_quality = params.settings.resample_quality;
+			flush = true;
+		}
+
+		// MAX_RS limits how fast we stream from the SD Card. The resampler itself costs the same at any rate.
 		if (params.settings.stereo_mode) {
 			if ((rs * s_sample.numChannels) > MAX_RS)
 				rs = MAX_RS / (float)s_sample.numChannels;
+		} else {
+			if (rs > MAX_RS)
+				rs = MAX_RS;
+		}
+		const uint64_t step = phase_step(rs);
+		const PlayFormat format = sampler_modes.cache[samplenum].format;
+		const uint32_t prev_out = buf.out;
 
+		if (params.settings.stereo_mode) {
 			if (s_sample.numChannels == 2) {
-				uint32_t t_u32 = play_buff[samplenum].out;
-				resample_read<WavChan::Left>(rs, &play_buff[samplenum], outL, params.reverse, flush);
-
-				play_buff[samplenum].out = t_u32;
-				resample_read<WavChan::Right>(rs, &play_buff[samplenum], outR, params.reverse, flush);
+				resample<WavChan::Stereo>(stream, format, step, rational, &buf, outL, outR, flush);
 
 			} else {
 				// MONO: read left channel and copy to right
-				bool flush = flags.read(Flag::PlayBuffDiscontinuity);
-				resample_read<WavChan::Mono>(rs, &play_buff[samplenum], outL, params.reverse, flush);
+				resample<WavChan::Mono>(stream, format, step, rational, &buf, outL, {}, flush);
 				for (unsigned i = 0; i < outL.size(); i++)
 					outR[i] = outL[i];
 			}
 		} else { // not STEREO_MODE:
-			if (rs > MAX_RS)
-				rs = MAX_RS;
-
 			if (s_sample.numChannels == 2)
-				resample_read<WavChan::Average>(rs, &play_buff[samplenum], outL, params.reverse, flush);
+				resample<WavChan::Average>(stream, format, step, rational, &buf, outL, {}, flush);
 			else
-				resample_read<WavChan::Mono>(rs, &play_buff[samplenum], outL, params.reverse, flush);
+				resample<WavChan::Mono>(stream, format, step, rational, &buf, outL, {}, flush);
 		}
 
+		// Release what the resampler consumed back to the loader
+		buf.played(CircularBuffer::distance_points(buf.out, prev_out, buf.size, params.reverse));
+
 		// TODO: if writing a flag gets expensive, then we could refactor this
-		// The only purpose of this flag is to set flush=true when
-		//  - loading A new sample, or
-		//  - When rs goes from ==1 to !=1
-		// Note that flush is ignored in resample_read when rs==1
-		if (rs == 1.f)
-			flags.set(Flag::PlayBuffDiscontinuity);
-		else
-			flags.clear(Flag::PlayBuffDiscontinuity);
+		// The only purpose of this flag is to set flush=true when loading a new sample or starting playback.
+		// The phase resampler keeps its history valid when rs is 1, so it does not need a flush when rs changes.
+		flags.clear(Flag::PlayBuffDiscontinuity);
 
 		apply_envelopes(outL, outR);
 	}
 
-	// Linear fade of stereo data in outL and outR
-	// Gain is a fixed gain to apply to all samples
-	// Set rate to < 0 to fade down, > 0 to fade up
-	// Returns amplitude applied to the last sample
-	// Note: this increments amplitude before applying to the first sample
-	static float fade(ChanBuff &outL, ChanBuff &outR, float gain, float starting_amp, float rate) {
-		float amp = starting_amp;
-
-		for (unsigned i = 0; i < outL.size(); i++) {
-			amp += rate;
-			if (amp >= 1.0f)
-				amp = 1.0f;
-			if (amp <= 0.f)
-				amp = 0.f;
-			outL[i] = (float)outL[i] * amp * gain;
-			outR[i] = (float)outR[i] * amp * gain;
-			outL[i] = __SSAT(outL[i], 24);
-			outR[i] = __SSAT(outR[i], 24);
-		}
-		return amp;
-	}
-
-	static void apply_gain(ChanBuff &outL, ChanBuff &outR, float gain) {
-		for (unsigned i = 0; i < outL.size(); i++) {
-			outL[i] = (float)outL[i] * gain;
-			outR[i] = (float)outR[i] * gain;
-			outL[i] = __SSAT(outL[i], 24);
-			outR[i] = __SSAT(outR[i], 24);
-		}
-	}
-
 	void apply_envelopes(ChanBuff &outL, ChanBuff &outR) {
 		if (flags.take(Flag::StartFadeUp))
 			env_level = 0.f;
@@ -183,13 +237,11 @@ public:
 
 		uint8_t samplenum = params.sample_num_now_playing;
 		uint8_t banknum = params.sample_bank_now_playing;
-		Sample *s_sample = &(samples[banknum][samplenum]);
+		Sample *s_sample = &sampler_modes.stream_sample(banknum, samplenum);
 
 		float length = params.length;
 		float gain = s_sample->inst_gain * params.volume;
-		float rs = (s_sample->sampleRate == params.settings.record_sample_rate) ?
-					   params.pitch :
-					   params.pitch * ((float)s_sample->sampleRate / (float)params.settings.record_sample_rate);
+		float rs = sampler_modes.stream_rs(samplenum);
 
 		// Update the start/endpos based on the length parameter
 		// Update the play_time (used to calculate led flicker and END OUT pulse width
@@ -231,16 +283,10 @@ public:
 				break;
 
 			case (PlayStates::PLAY_FADEUP):
-				if (params.settings.fadeupdown_env) {
+				if (params.settings.fadeupdown_env)
 					env_rate = params.settings.fade_up_rate;
-					env_level = fade(outL, outR, gain, env_level, env_rate);
-					if (env_level >= 1.f)
-						params.play_state = PlayStates::PLAYING;
-
-				} else {
-					apply_gain(outL, outR, gain);
+				if (fade_up_block(outL, outR, gain, env_level, env_rate, params.settings.fadeupdown_env))
 					params.play_state = PlayStates::PLAYING;
-				}
 				break;
 
 			case (PlayStates::PERC_FADEUP):
@@ -265,15 +311,9 @@ public:
 				break;
 
 			case (PlayStates::PLAY_FADEDOWN):
-				if (params.settings.fadeupdown_env) {
+				if (params.settings.fadeupdown_env)
 					env_rate = params.settings.fade_down_rate;
-					env_level = fade(outL, outR, gain, env_level, -1.f * env_rate);
-				} else {
-					apply_gain(outL, outR, gain);
-					env_level = 0.f; // set this so we detect "end of fade" in the next block
-				}
-
-				if (env_level <= 0.f) {
+				if (fade_down_block(outL, outR, gain, env_level, env_rate, params.settings.fadeupdown_env)) {
 					flicker_endout(play_time);
 
 					// Start playing again if we're looping, unless we faded down because of a play trigger
@@ -2,6 +2,7 @@
 #include "audio_stream_conf.hh"
 #include "circular_buffer.hh"
 #include "elements.hh"
+#include "play_format.hh"
 #include "sample_type.hh"
 #include <algorithm>
 
@@ -59,14 +60,14 @@ inline float calc_fast_perc_fade_rate(float length, float sample_rate) {
 
 // calc_resampled_cache_size()
 // Amount an imaginary pointer in the sample file would move with each audio block sent to the codec
-inline uint32_t calc_resampled_cache_size(const Sample &sample, uint32_t resampled_buffer_size) {
-	return ((resampled_buffer_size * sample.sampleByteSize) / 2);
+inline uint32_t calc_resampled_cache_size(const Sample &sample, uint32_t resampled_buffer_size, PlayFormat format) {
+	return ((resampled_buffer_size * sample.sampleByteSize) / play_bytes(format));
 }
 
 // calc_resampled_buffer_size()
 // Amount play_buff[]->out changes with each audio block sent to the codec
-inline uint32_t calc_resampled_buffer_size(const Sample &sample, float resample_rate) {
-	return ((uint32_t)((FramesPerBlock * sample.numChannels * 2) * resample_rate));
+inline uint32_t calc_resampled_buffer_size(const Sample &sample, float resample_rate, PlayFormat format) {
+	return ((uint32_t)((FramesPerBlock * sample.numChannels * play_bytes(format)) * resample_rate));
 }
 
 inline uint32_t ceil(float num) {
@@ -132,6 +133,17 @@ inline uint32_t calc_start_point(float start_param, Sample *const sample, int an
 	return align_addr((zeropt + ((uint32_t)(start_param * (float)inst_size))), sample->blockAlign);
 }
 
+// File position an idle slot's prefetch starts at, for a start position (see SampleLoader::prefetch_step())
+inline uint32_t calc_prefetch_start(uint32_t startpos) {
+	return startpos > PREFETCH_MARGIN ? startpos - PREFETCH_MARGIN : 0;
+}
+
+// Whether a prefetch that starts at prefetch_low is kept for startpos. It's kept while startpos stays within a read
+// block after its start, so the prefetch is restarted once for a move of the Start knob, and not for noise
+inline bool prefetch_covers(uint32_t prefetch_low, uint32_t startpos) {
+	return prefetch_low <= startpos && startpos - prefetch_low <= READ_BLOCK_SIZE;
+}
+
 // Returns an offset from the startpos, based on the length  and resampling rate
 inline uint32_t calc_stop_point(
 	float length_param, float resample_param, Sample *sample, uint32_t startpos, int anchor_cuenum, float sample_rate) {
@@ -1,9 +1,11 @@
 #pragma once
 #include "bank.hh"
 #include "circular_buffer.hh"
+#include "file_read_buffers.hh"
 #include "flags.hh"
 #include "log.hh"
 #include "params.hh"
+#include "read_tuner.hh"
 #include "sampler_modes.hh"
 #include "sdcard.hh"
 
@@ -22,6 +24,13 @@ class SampleLoader {
 	mdrivlib::Timekeeper sdcard_update_task;
 	bool time_to_update = false;
 
+	// Bank being prefetched, and the slots of it that failed to open or read (bit per slot)
+	uint8_t prefetch_bank = MaxNumBanks;
+	uint32_t prefetch_failed = 0;
+
+	// Set when the last prefetch step found nothing to read
+	bool prefetch_idle = false;
+
 public:
 	SampleLoader(SamplerModes &sampler_modes,
 				 Params &params,
@@ -47,16 +56,26 @@ public:
 			[this]() { time_to_update = true; });
 	}
 
-	void start() { sdcard_update_task.start(); }
+	// Whether the loader has nothing to read: nothing is playing, and there's nothing left to prefetch
+	bool idle() const { return params.play_state == PlayStates::SILENT && prefetch_idle; }
+
+	void start() {
+		read_tuner.set_card_speed(sd.sdcard_ops.RxTestBlocks * 512, sd.sdcard_ops.rx_test_ms);
+		sdcard_update_task.start();
+	}
 
 	void update() {
+		s.finish_play_buff_copy(false);
+
 		if (time_to_update) {
 			time_to_update = false;
 			read_storage_to_buffer();
 		}
 	}
 
-	uint32_t file_read_buffer[(READ_BLOCK_SIZE >> 2) + 2];
+	using ReadBuffers = FileReadBuffers<READ_BLOCK_SIZE>;
+	ReadBuffers read_buffers;
+	ReadTuner read_tuner;
 
 	void read_storage_to_buffer() {
 		uint32_t err;
@@ -68,23 +87,35 @@ public:
 		// convenience variables
 		uint8_t samplenum, banknum;
 		Sample *s_sample;
-		FSIZE_t t_fptr;
+		const uint8_t *block;
 		float resample_amt;
 
 		check_change_sample();
 		check_change_bank();
 
+		// Before the early return, so a slot that stops while prebuffering stops counting
+		const uint32_t now = HAL_GetTick();
+		for (unsigned i = 0; i < NumSamplesPerBank; i++)
+			s.stream_stats[i].record_prebuffering(
+				now, i == params.sample_num_now_playing && params.play_state == PlayStates::PREBUFFERING);
+
 		if ((params.play_state == PlayStates::SILENT) || (params.play_state == PlayStates::PLAY_FADEDOWN) ||
 			(params.play_state == PlayStates::RETRIG_FADEDOWN))
+		{
+			prefetch_step();
 			return;
+		}
 
 		samplenum = params.sample_num_now_playing;
 		banknum = params.sample_bank_now_playing;
-		s_sample = &(samples[banknum][samplenum]);
+		s_sample = &s.stream_sample(banknum, samplenum);
 
 		// FixMe: Calculate play_buff_bufferedamt after play_buff changes, not here, then make bufferedmat private
 		// again
-		s.play_buff_bufferedamt[samplenum] = play_buff[samplenum].distance(params.reverse);
+		s.play_buff_bufferedamt[samplenum] = std::max(play_buff[samplenum].fill(), 0);
+		s.stream_stats[samplenum].record_fill(s.play_buff_bufferedamt[samplenum],
+											  play_buff[samplenum].size,
+											  params.play_state != PlayStates::PREBUFFERING);
 
 		//
 		// Try to recover from a file read error
@@ -118,14 +149,20 @@ public:
 		//
 		// Calculate the amount to pre-buffer before we play:
 		//
-		resample_amt = params.pitch * (float)s_sample->sampleRate / (float)params.settings.record_sample_rate;
+		resample_amt = s.stream_rs(samplenum);
 		float max_rs = params.settings.stereo_mode ? MAX_RS / s_sample->numChannels : MAX_RS;
 		if (resample_amt > max_rs)
 			resample_amt = max_rs;
 
-		// Calculate how many bytes we need to pre-load in our buffer
-		uint32_t pre_buff_amt =
-			(float)(BASE_BUFFER_THRESHOLD * s_sample->blockAlign * s_sample->numChannels) * resample_amt;
+		// Bytes per ms the slot plays from its file, and from play_buff
+		const float file_rate = params.settings.record_sample_rate * s_sample->blockAlign * resample_amt / 1000.f;
+		const float play_rate = file_rate * play_bytes(s.cache[samplenum].format) / s_sample->sampleByteSize;
+		const uint32_t read_size = read_tuner.read_size(file_rate);
+
+		// Calculate how many bytes we need to pre-load in our buffer: enough to cover the slowest recent read
+		uint32_t pre_buff_amt = read_tuner.prebuffer(
+			play_rate,
+			(uint32_t)((float)(BASE_BUFFER_THRESHOLD * s_sample->blockAlign * s_sample->numChannels) * resample_amt));
 		uint32_t playback_buff_amt = std::clamp(pre_buff_amt * 4, uint32_t{0}, (play_buff[samplenum].size * 7) / 10);
 		uint32_t target_buff_amt = params.play_state == PlayStates::PREBUFFERING ? pre_buff_amt : playback_buff_amt;
 
@@ -146,12 +183,12 @@ public:
 			} else {
 				// Forward reading:
 				if (params.reverse == 0) {
-					rd = s_sample->inst_end - s.sample_file_curpos[samplenum];
+					rd = plan_read(samplenum, *s_sample, s_sample->inst_end - s.sample_file_curpos[samplenum], read_size);
 
-					if (rd > READ_BLOCK_SIZE)
-						rd = READ_BLOCK_SIZE;
-
-					res = f_read(&s.fil[samplenum], file_read_buffer, rd, &br);
+					auto rb = read_forward(samplenum, *s_sample, rd);
+					res = rb.res;
+					br = rb.bytes_read;
+					block = rb.data;
 
 					if (res != FR_OK) {
 						// FixMe: Do we really want to set this in case of disk error? We don't when reversing.
@@ -174,100 +211,41 @@ public:
 					}
 
 				} else {
-					// Reverse reading:
-					rd = s.sample_file_curpos[samplenum] > s_sample->inst_start ?
-							 s.sample_file_curpos[samplenum] - s_sample->inst_start :
-							 0;
-
-					if (rd >= READ_BLOCK_SIZE) {
-						// Jump back a block
-						rd = READ_BLOCK_SIZE;
-
-						t_fptr = f_tell(&s.fil[samplenum]);
-						res = f_lseek(&s.fil[samplenum], t_fptr - READ_BLOCK_SIZE);
-						if (res || (f_tell(&s.fil[samplenum]) != (t_fptr - READ_BLOCK_SIZE)))
-							g_error |= LSEEK_FPTR_MISMATCH;
-
-						s.sample_file_curpos[samplenum] = f_tell(&s.fil[samplenum]) - s_sample->startOfData;
-
-					} else {
-						// rd < READ_BLOCK_SIZE: read the first block
-						// (which is the last to be read, since we're reversing)
-						// TODO: align rd to 24?
-
-						// Jump to the beginning
-						s.sample_file_curpos[samplenum] = s_sample->inst_start;
-						res = s.set_file_pos(banknum, samplenum);
-						if (res != FR_OK)
-							g_error |= FILE_SEEK_FAIL;
-
-						s.is_buffered_to_file_end[samplenum] = 1;
-					}
-
-					// Read one block forward
-					t_fptr = f_tell(&s.fil[samplenum]);
-					res = f_read(&s.fil[samplenum], file_read_buffer, rd, &br);
+					// Reverse reading: the chunk before sample_file_curpos
+					auto rb = read_reverse(banknum, samplenum, *s_sample, rd);
+					res = rb.res;
+					br = rb.bytes_read;
+					block = rb.data;
 					if (res != FR_OK)
 						g_error |= FILE_READ_FAIL_1;
 
 					if (br < rd)
 						g_error |= FILE_UNEXPECTEDEOF;
-
-					// Jump backwards to where we started reading
-					res = f_lseek(&s.fil[samplenum], t_fptr);
-					if (res != FR_OK)
-						g_error |= FILE_SEEK_FAIL;
-					if (f_tell(&s.fil[samplenum]) != t_fptr)
-						g_error |= LSEEK_FPTR_MISMATCH;
 				}
 
 				// Write temporary buffer to play_buff[]->in
 				if (res != FR_OK)
 					g_error |= FILE_READ_FAIL_1;
 				else {
+					s.stream_stats[samplenum].bytes_streamed += br;
+
+					const uint32_t num_samples = rd / s_sample->sampleByteSize;
+					const uint32_t buffered_bytes = num_samples * play_bytes(s.cache[samplenum].format);
+
 					// Jump back in play_buff by the amount just read (re-sized from file addresses to buffer
 					// address)
 					if (params.reverse)
-						play_buff[samplenum].offset_in_address((rd * 2) / s_sample->sampleByteSize, 1);
+						play_buff[samplenum].offset_in_address(buffered_bytes, 1);
 
-					err = 0;
-
-					//
-					// Write raw file data (tmp_buff_u32) into buffer (play_buff)
-					//
-
-					// 16 bit
-					if (s_sample->sampleByteSize == 2)
-						err = play_buff[samplenum].memory_write_16as16((uint32_t *)file_read_buffer, rd >> 2, 0);
-
-					// 24bit (rd must be a multiple of 3)
-					else if (s_sample->sampleByteSize == 3)
-						err = play_buff[samplenum].memory_write_24as16((uint8_t *)file_read_buffer, rd, 0);
-
-					// 8bit
-					else if (s_sample->sampleByteSize == 1)
-						err = play_buff[samplenum].memory_write_8as16((uint8_t *)file_read_buffer, rd, 0);
-
-					// 32-bit float (rd must be a multiple of 4)
-					else if (s_sample->sampleByteSize == 4 && s_sample->PCM == 3)
-						err = play_buff[samplenum].memory_write_32fas16((float *)file_read_buffer, rd >> 2, 0);
-
-					// 32-bit int rd must be a multiple of 4
-					else if (s_sample->sampleByteSize == 4 && s_sample->PCM == 1)
-						err = play_buff[samplenum].memory_write_32ias16((uint8_t *)file_read_buffer, rd, 0);
+					err = write_play_buff(samplenum, *s_sample, block, num_samples);
 
 					// Update the cache addresses
 					if (params.reverse) {
-						// Ignore head crossing error if we are reversing and ended up with in==out (that's
-						// normal for the first reading)
-						if (err && (play_buff[samplenum].in == play_buff[samplenum].out))
-							err = 0;
-
 						//
 						// Jump back again in play_buff by the amount just read (re-sized from file addresses to
 						// buffer address) This ensures play_buff[]->in points to the buffer seam
 						//
-						play_buff[samplenum].offset_in_address((rd * 2) / s_sample->sampleByteSize, 1);
+						play_buff[samplenum].offset_in_address(buffered_bytes, 1);
 
 						s.cache[samplenum].low = s.sample_file_curpos[samplenum];
 						s.cache[samplenum].map_pt = play_buff[samplenum].in;
@@ -284,11 +262,14 @@ public:
 						}
 					}
 
-					if (err)
+					if (err) {
 						g_error |= READ_BUFF1_OVERRUN;
+						s.stream_stats[samplenum].overruns++;
+					}
 				}
 			}
-		}
+		} else
+			prefetch_step();
 
 		// Check if we've prebuffered enough to start playing
 		if ((s.is_buffered_to_file_end[samplenum] || s.play_buff_bufferedamt[samplenum] >= pre_buff_amt) &&
@@ -303,6 +284,310 @@ public:
 		}
 	}
 
+	// Whether a slot stores its samples in play_buff as they are in the file (16-bit PCM)
+	bool stored_as_read(uint8_t samplenum, const Sample &sample) {
+		return s.cache[samplenum].format == PlayFormat::S16 &&
+			   FormatConvert::for_format(sample.sampleByteSize, sample.PCM) == FormatConvert::s16;
+	}
+
+	// Reads rd bytes from a slot's file position, to be written forward to play_buff by write_play_buff().
+	// Samples stored as they are in the file are read straight into play_buff if the run at the in ptr doesn't wrap,
+	// and is word-aligned for the SD card's DMA. That saves copying them through SRAM. Otherwise, or at the wrap,
+	// they are read into read_buffers.
+	ReadBuffers::Block read_forward(uint8_t samplenum, const Sample &sample, uint32_t rd) {
+		if (stored_as_read(samplenum, sample)) {
+			if (uint32_t dst = play_buff[samplenum].contiguous_in(rd, 4))
+				return read_in_place(samplenum, dst, rd);
+		}
+		return read_block(samplenum, rd);
+	}
+
+	// Reads the chunk of a slot's file that ends at sample_file_curpos, for playing in reverse, and moves
+	// sample_file_curpos back to the start of it. The chunk size is returned in rd.
+	// A chunk is one seek to its offset and one read. The file position is left at the end of the chunk, since
+	// start_playing() and reverse_file_positions() seek before reading forward again. Chunks are as large as
+	// possible, as each one costs a seek (see reverse_read_size()), and start on a sector boundary after the first
+	// (see ReadTuner::reverse_aligned_read()). Samples stored as read go straight into play_buff, in file order just
+	// before the in ptr, where the reverse write in read_storage_to_buffer() puts them.
+	ReadBuffers::Block read_reverse(uint8_t banknum, uint8_t samplenum, const Sample &sample, uint32_t &rd) {
+		const uint32_t end = s.sample_file_curpos[samplenum];
+		const uint32_t left = end > sample.inst_start ? end - sample.inst_start : 0;
+		auto chunk = [&](uint32_t max_rd) {
+			return left > max_rd ?
+					   ReadTuner::reverse_aligned_read(
+						   sample.startOfData + end, max_rd, sample.startOfData, sample.blockAlign) :
+					   left;
+		};
+
+		rd = chunk(reverse_read_size(samplenum, sample));
+		// A chunk larger than the read buffers can only be read in place
+		if (rd > ReadTuner::MaxReadSize && !play_buff[samplenum].contiguous_before_in(rd, 4))
+			rd = chunk(ReadTuner::MaxReadSize);
+
+		// The first chunk of the sample is the last to be read
+		if (rd == left)
+			s.is_buffered_to_file_end[samplenum] = 1;
+
+		s.sample_file_curpos[samplenum] = end - rd;
+		FRESULT res = s.set_file_pos(banknum, samplenum);
+		if (res != FR_OK) {
+			g_error |= FILE_SEEK_FAIL;
+			return {res, 0, nullptr};
+		}
+
+		if (stored_as_read(samplenum, sample)) {
+			if (uint32_t dst = play_buff[samplenum].contiguous_before_in(rd, 4))
+				return read_in_place(samplenum, dst, rd);
+		}
+		return read_block(samplenum, rd);
+	}
+
+	// Largest chunk to read in reverse. Samples stored as read can go straight into play_buff, so their chunks fill
+	// the room before the in ptr, in whole granules, up to ReadTuner::MaxReverseReadSize. Others go through
+	// read_buffers, so they are ReadTuner::MaxReadSize
+	uint32_t reverse_read_size(uint8_t samplenum, const Sample &sample) {
+		if (!stored_as_read(samplenum, sample))
+			return ReadTuner::MaxReadSize;
+		uint32_t room = play_buff[samplenum].room_before_in() / ReadTuner::ReadGranule * ReadTuner::ReadGranule;
+		return std::clamp(room, ReadTuner::MaxReadSize, ReadTuner::MaxReverseReadSize);
+	}
+
+	// Reads rd bytes from a slot's file position straight to play_buff address dst, timing the read for read_tuner.
+	// write_play_buff() then moves the in ptr past them and publishes them, so a DMA copy to play_buff must be
+	// finished first: the audio ISR's fill count would otherwise cover the copy before it lands.
+	ReadBuffers::Block read_in_place(uint8_t samplenum, uint32_t dst, uint32_t rd) {
+		s.finish_play_buff_copy();
+		const uint32_t start = HAL_GetTick();
+		ReadBuffers::Block block{FR_OK, 0, reinterpret_cast<const uint8_t *>(dst)};
+		block.res = f_read(&s.fil[samplenum], reinterpret_cast<void *>(dst), rd, &block.bytes_read);
+		read_tuner.record_read(block.bytes_read, HAL_GetTick() - start);
+		return block;
+	}
+
+	// Bytes to read forward from a slot's file position, with rd left to read and max_rd the most in one read.
+	// A full-size read is shortened to end on a sector boundary, which keeps the reads after it sector-aligned
+	// (see ReadTuner::sector_aligned_read()). The last read of the sample is left as it is.
+	uint32_t plan_read(uint8_t samplenum, const Sample &sample, uint32_t rd, uint32_t max_rd) {
+		if (rd < max_rd)
+			return rd;
+		return ReadTuner::sector_aligned_read(
+			f_tell(&s.fil[samplenum]), max_rd, sample.startOfData, sample.blockAlign);
+	}
+
+	// Reads rd bytes from a slot's file position into read_buffers, timing the read for read_tuner
+	ReadBuffers::Block read_block(uint8_t samplenum, uint32_t rd) {
+		const uint32_t start = HAL_GetTick();
+		auto block = read_buffers.read(
+			&s.fil[samplenum], rd, [this](const uint8_t *buf) { s.finish_play_buff_copy_from(buf); });
+		read_tuner.record_read(block.bytes_read, HAL_GetTick() - start);
+		return block;
+	}
+
+	// Converts num_samples samples read from the file to the slot's cache format, and writes them to play_buff[]->in.
+	// 16-bit PCM is copied by DMA (unless it was read in place), and published when the copy finishes. Otherwise the
+	// new data is published to the audio ISR now, and it's an overrun if that leaves more in play_buff than it holds:
+	// returns true if so. (The exact count replaces the head-crossing check, which also fired on the normal in == out
+	// of the first reverse read.)
+	bool write_play_buff(uint8_t samplenum, const Sample &sample, const uint8_t *data, uint32_t num_samples) {
+		const auto format = s.cache[samplenum].format;
+		auto &buf = play_buff[samplenum];
+
+		bool converted = false;
+		if (stored_as_read(samplenum, sample)) {
+			if (data == reinterpret_cast<const uint8_t *>(buf.in)) {
+				// Already there (see read_in_place())
+				buf.offset_in_address(num_samples * 2, 0);
+				converted = true;
+			} else {
+				// Nothing to convert, so DMA can do it
+				s.start_play_buff_copy(samplenum, (const int16_t *)data, num_samples);
+			}
+		} else if (format == PlayFormat::Adpcm) {
+			// Only whole blocks are encoded, so the frames of a block the next read completes are published then
+			if (auto convert = FormatConvert::for_format(sample.sampleByteSize, sample.PCM)) {
+				auto &store = s.adpcm[samplenum];
+				uint32_t bytes = store.write(buf, data, num_samples, sample.sampleByteSize, convert, params.reverse);
+				if (s.is_buffered_to_file_end[samplenum])
+					bytes += store.flush();
+				buf.written(bytes);
+				return buf.fill() > (int32_t)buf.size;
+			}
+		} else
+			converted = write_converted(buf, format, sample, data, num_samples);
+
+		if (!converted)
+			return false;
+		buf.written(num_samples * play_bytes(format));
+		return buf.fill() > (int32_t)buf.size;
+	}
+
+	// Converts num_samples samples from data to format (other than ADPCM), and writes them to buf's in ptr
+	// with the CPU. Returns false if the sample format can't be converted
+	bool write_converted(
+		CircularBuffer &buf, PlayFormat format, const Sample &sample, const uint8_t *data, uint32_t num_samples) {
+		if (format == PlayFormat::S16) {
+			if (auto convert = FormatConvert::for_format(sample.sampleByteSize, sample.PCM)) {
+				buf.memory_write_as16(data, num_samples, sample.sampleByteSize, convert, 0);
+				return true;
+			}
+		} else if (auto store = FormatConvert::for_storage(format, sample.sampleByteSize, sample.PCM)) {
+			buf.memory_write_as(data, num_samples, sample.sampleByteSize, store, play_bytes(format), 0);
+			return true;
+		}
+		return false;
+	}
+
+	// Reads one block into an idle slot of the selected bank, when the playing slot doesn't need reading.
+	// Each slot gets PREFETCH_SIZE of its sample from the position the Start knob (and cues) would start it at,
+	// so after a bank change any slot can start playing without PREBUFFERING. Moving the Start knob more than
+	// a read block from where the prefetch began restarts the slot's prefetch there.
+	// Only forward playback is prefetched: reverse starts from the end of the region, and it's rarely cached.
+	void prefetch_step() {
+		prefetch_idle = true;
+		if (params.reverse || params.rec_state != RecStates::REC_OFF)
+			return;
+		prefetch_idle = false;
+
+		if (params.bank != prefetch_bank) {
+			prefetch_bank = params.bank;
+			prefetch_failed = 0;
+		}
+
+		// Cue pins of the playing sample come first, then the heads of the idle slots, then their cue pins
+		if (params.play_state != PlayStates::SILENT &&
+			pin_read(params.sample_bank_now_playing, params.sample_num_now_playing))
+			return;
+
+		for (uint8_t samplenum = 0; samplenum < NumSamplesPerBank; samplenum++) {
+			if (prefetch_read(params.bank, samplenum))
+				return;
+		}
+
+		for (uint8_t samplenum = 0; samplenum < NumSamplesPerBank; samplenum++) {
+			if (slot_idle(samplenum) && pin_read(params.bank, samplenum))
+				return;
+		}
+		prefetch_idle = true;
+	}
+
+	// The playing slot's file and play_buff belong to the stream until it's silent
+	bool slot_idle(uint8_t samplenum) {
+		return samplenum != params.sample_num_now_playing || params.play_state == PlayStates::SILENT;
+	}
+
+	// Returns true if it read from the card
+	bool prefetch_read(uint8_t banknum, uint8_t samplenum) {
+		if (!slot_idle(samplenum))
+			return false;
+
+		// New recordings are reloaded by start_playing(), and slots streaming an octave sidecar keep it open
+		Sample &sample = samples[banknum][samplenum];
+		bool is_open = s.fil[samplenum].obj.fs && s.file_bank[samplenum] == banknum;
+		if (sample.filename[0] == 0 || sample.file_status == FileStatus::NewFile ||
+			(is_open && s.stream_octave[samplenum]) || (prefetch_failed & (1 << samplenum)))
+			return false;
+
+		int cuenum = (params.settings.use_cues && sample.num_cues > 0) ? calc_start_cuenum(params.start, &sample) : -1;
+		uint32_t startpos = calc_start_point(params.start, &sample, cuenum, params.settings.use_cues);
+
+		auto &cache = s.cache[samplenum];
+		bool reading_forward = is_open && !s.cached_rev_state[samplenum] && s.sample_file_curpos[samplenum] == cache.high;
+
+		if (reading_forward && cache.low <= startpos && startpos <= cache.high &&
+			(s.is_buffered_to_file_end[samplenum] || cache.high - startpos >= PREFETCH_SIZE))
+			return false;
+
+		// Keep reading a prefetch, or start a new one. (Only a cache that begins just before startpos is extended,
+		// since the slot's out ptr is left wherever it last played.)
+		if (!reading_forward || !prefetch_covers(cache.low, startpos)) {
+			if (s.start_prefetch(banknum, samplenum, calc_prefetch_start(startpos)) != FR_OK) {
+				prefetch_failed |= 1 << samplenum;
+				return false;
+			}
+		}
+
+		uint32_t rd = plan_read(samplenum,
+								sample,
+								sample.inst_end > s.sample_file_curpos[samplenum] ?
+									sample.inst_end - s.sample_file_curpos[samplenum] :
+									0,
+								READ_BLOCK_SIZE);
+		ReadBuffers::Block rb{FR_OK, 0, nullptr};
+		if (rd)
+			rb = read_forward(samplenum, sample, rd);
+		if (rb.res != FR_OK) {
+			f_close(&s.fil[samplenum]);
+			prefetch_failed |= 1 << samplenum;
+			return true;
+		}
+		const UINT br = rb.bytes_read;
+
+		s.sample_file_curpos[samplenum] = f_tell(&s.fil[samplenum]) - sample.startOfData;
+		if (br < rd || s.sample_file_curpos[samplenum] >= sample.inst_end)
+			s.is_buffered_to_file_end[samplenum] = 1;
+
+		s.stream_stats[samplenum].bytes_streamed += br;
+		if (br && write_play_buff(samplenum, sample, rb.data, br / sample.sampleByteSize))
+			s.stream_stats[samplenum].overruns++;
+		cache.high = s.sample_file_curpos[samplenum];
+		return true;
+	}
+
+	// Reads one block of the first unfilled cue pin of a slot (see cue_pins.hh), from the slot's open file.
+	// The file position is put back, since the slot may be streaming. Returns true if it read from the card
+	bool pin_read(uint8_t banknum, uint8_t samplenum) {
+		Sample &sample = samples[banknum][samplenum];
+		if (!params.settings.use_cues || sample.num_cues == 0 || !s.cue_pins_ready(banknum, samplenum) ||
+			(prefetch_failed & (1 << samplenum)))
+			return false;
+
+		auto &pins = s.cue_pins[samplenum];
+		const auto format = s.cache[samplenum].format;
+
+		for (unsigned i = 0; i < CuePins::NumPins; i++) {
+			uint32_t pos = CuePins::pin_pos(sample, i);
+			if (pos == CuePins::NoPin)
+				continue;
+
+			if (pins[i].pos != pos || pins.format() != format)
+				pins.start(i, pos, format);
+
+			uint32_t pin_size = CuePins::pin_size(sample, pos);
+			if (pins[i].file_bytes >= pin_size)
+				continue;
+
+			uint32_t rd = std::min(pin_size - pins[i].file_bytes, READ_BLOCK_SIZE);
+			FSIZE_t t_fptr = f_tell(&s.fil[samplenum]);
+			ReadBuffers::Block rb{FR_OK, 0, nullptr};
+			FRESULT res = f_lseek(&s.fil[samplenum], sample.startOfData + pos + pins[i].file_bytes);
+			if (res == FR_OK) {
+				rb = read_block(samplenum, rd);
+				res = rb.res;
+			}
+			const UINT br = rb.bytes_read;
+
+			// Jump back to where the stream is reading
+			if (f_lseek(&s.fil[samplenum], t_fptr) != FR_OK || f_tell(&s.fil[samplenum]) != t_fptr)
+				g_error |= FILE_SEEK_FAIL;
+
+			if (res != FR_OK || br < rd) {
+				pins.start(i, CuePins::NoPin, format);
+				prefetch_failed |= 1 << samplenum;
+				return true;
+			}
+
+			CircularBuffer pin_buff;
+			pins.attach(i, pin_buff);
+			const uint32_t num_samples = br / sample.sampleByteSize;
+			if (write_converted(pin_buff, format, sample, rb.data, num_samples))
+				pins.appended(i, br, num_samples * play_bytes(format));
+			else
+				prefetch_failed |= 1 << samplenum;
+			return true;
+		}
+		return false;
+	}
+
 	void check_change_bank() {
 		if (flags.take(Flag::PlayBankChanged)) {
 
@@ -1,14 +1,22 @@
 #pragma once
+#include "adpcm.hh"
 #include "audio_memory.hh"
 #include "audio_stream_conf.hh"
 #include "bank.hh"
 #include "cache.hh"
 #include "circular_buffer.hh"
+#include "cue_pins.hh"
+#include "dma_copy.hh"
 #include "errors.hh"
 #include "flags.hh"
+#include "log.hh"
+#include "octave_sidecar_builder.hh"
 #include "params.hh"
+#include "play_buff_dma.hh"
+#include "resample.hh"
 #include "sampler_calcs.hh"
 #include "sdcard.hh"
+#include "stream_stats.hh"
 #include "wav_recording.hh"
 
 namespace SamplerKit
@@ -16,6 +24,7 @@ namespace SamplerKit
 
 class SamplerModes {
 	static constexpr uint32_t NUM_SAMPLES_PER_BANK = NumSamplesPerBank;
+	static constexpr uint32_t PlayBuffSlotSize = (Brain::MemorySizeBytes / NumSamplesPerBank) & 0xFFFFF000; // align
 
 	Params &params;
 	Flags &flags;
@@ -23,6 +32,7 @@ class SamplerModes {
 	SampleList &samples;
 	BankManager &banks;
 	Recorder &recorder;
+	OctaveSidecarBuilder &sidecars;
 
 	std::array<CircularBuffer, NumSamplesPerBank> &play_buff;
 	uint32_t &g_error;
@@ -32,6 +42,10 @@ class SamplerModes {
 
 	uint32_t last_play_start_tmr;
 
+	// The DMA copy to play_buff that finish_play_buff_copy() will publish
+	PlayBuffDma<DmaCopy> play_buff_dma;
+	uint8_t copy_samplenum = 0;
+
 public:
 	// file position where we began playback.
 	uint32_t sample_file_startpos;
@@ -49,17 +63,38 @@ public:
 	FIL fil[NumSamplesPerBank];
 	Cache cache[NumSamplesPerBank];
 
+	// Compressed storage of each slot's play_buff, used when its cache format is PlayFormat::Adpcm
+	std::array<AdpcmStore, NumSamplesPerBank> adpcm;
+
+	// Start of each cue region of each slot's sample, when playing with cues
+	std::array<CuePins, NumSamplesPerBank> cue_pins;
+
 	// Whether file is totally cached (from inst_start to inst_end)
 	bool is_buffered_to_file_end[NumSamplesPerBank];
 	uint32_t play_buff_bufferedamt[NumSamplesPerBank];
 	bool cached_rev_state[NumSamplesPerBank];
+
+	// Buffer fill, underrun and overrun statistics of each slot, since boot or reset_stream_stats()
+	std::array<StreamStats, NumSamplesPerBank> stream_stats{};
 	///////////////
 
+	// Octave sidecar level being streamed for each slot (0 streams the sample itself), and its Sample info
+	std::array<uint8_t, NumSamplesPerBank> stream_octave{};
+	std::array<Sample, NumSamplesPerBank> sidecar_sample;
+
+	// Rate of each slot's stream_sample() relative to the codec rate, set when playback starts
+	std::array<RateRatio, NumSamplesPerBank> stream_rate{};
+
+	// Bank of the sample whose file is open in each slot's fil. Slots prefetched from the selected bank
+	// stay open when playback changes to that bank.
+	std::array<uint8_t, NumSamplesPerBank> file_bank{};
+
 	SamplerModes(Params &params,
 				 Flags &flags,
 				 Sdcard &sd,
 				 BankManager &banks,
 				 Recorder &recorder,
+				 OctaveSidecarBuilder &sidecars,
 				 std::array<CircularBuffer, NumSamplesPerBank> &splay_buff,
 				 uint32_t &g_error)
 		: params{params}
@@ -68,20 +103,19 @@ public:
 		, samples{banks.samples}
 		, banks{banks}
 		, recorder{recorder}
+		, sidecars{sidecars}
 		, play_buff{splay_buff}
 		, g_error{g_error} {
 
 		Memory::clear();
-		const auto slot_size = (Brain::MemorySizeBytes / NumSamplesPerBank) & 0xFFFFF000; // align
+		DmaCopy::init();
 		for (unsigned i = 0; i < NumSamplesPerBank; i++) {
-			play_buff[i].min = Brain::MemoryStartAddr + (i * slot_size);
-			play_buff[i].max = play_buff[i].min + slot_size;
-			play_buff[i].size = slot_size;
-
-			play_buff[i].in = play_buff[i].min;
-			play_buff[i].out = play_buff[i].min;
+			play_buff[i].min = Brain::MemoryStartAddr + (i * PlayBuffSlotSize);
+			play_buff[i].max = play_buff[i].min + PlayBuffSlotSize;
+			play_buff[i].size = PlayBuffSlotSize;
 
-			play_buff[i].wrapping = 0;
+			play_buff[i].init();
+			cue_pins[i].set_base(play_buff[i].min + PlayBuffSlotSize - CuePins::ReservedBytes);
 
 			cache[i].map_pt = play_buff[i].min;
 			cache[i].low = 0;
@@ -105,6 +139,15 @@ public:
 		flags.set(Flag::ForceFileReload);
 	}
 
+	// The Sample whose file is being streamed into a slot's play_buff: either the sample or one of its octave sidecars.
+	// All file positions, sizes and rates of a slot refer to this Sample.
+	Sample &stream_sample(uint8_t banknum, uint8_t samplenum) {
+		return stream_octave[samplenum] ? sidecar_sample[samplenum] : samples[banknum][samplenum];
+	}
+
+	// Resample rate of a slot's stream at the current pitch
+	float stream_rs(uint8_t samplenum) const { return params.pitch * stream_rate[samplenum].ratio; }
+
 	// FIXME: Split up the state machinery and the sd card IO
 	// Then only call the SD card io from the main loop update()
 	// And call the state machinery in the audio callback (before/after params.update())
@@ -150,6 +193,11 @@ public:
 			flags.set(Flag::ToggleStereoModeAnimate);
 		}
 
+		if (flags.take(Flag::LogStreamStats)) {
+			log_stream_stats();
+			reset_stream_stats();
+		}
+
 		if (flags.take(Flag::EnterPlayMode))
 			params.op_mode = OperationMode::Playback;
 
@@ -177,16 +225,72 @@ public:
 		}
 	}
 
+	// Loader: starts copying 16-bit samples from src to play_buff by DMA. The copy overlaps with the rest of the
+	// main loop and the next file read, and is published to the audio ISR by finish_play_buff_copy().
+	// A copy still running from the last call is finished first.
+	void start_play_buff_copy(uint8_t samplenum, const int16_t *src, uint32_t num_samples) {
+		finish_play_buff_copy();
+		play_buff_dma.start(play_buff[samplenum], src, num_samples);
+		copy_samplenum = samplenum;
+	}
+
+	// Publishes the DMA copy to play_buff once it's done, and returns true if none is left running.
+	// With wait set, it waits for the copy: anything that moves play_buff's pointers must do this first.
+	bool finish_play_buff_copy(bool wait = true) {
+		if (!play_buff_dma.pending())
+			return true;
+		auto buf = play_buff_dma.finish(wait);
+		if (!buf)
+			return false;
+
+		// It's an overrun if that leaves more in play_buff than it holds
+		if (buf->fill() > (int32_t)buf->size) {
+			g_error |= READ_BUFF1_OVERRUN;
+			stream_stats[copy_samplenum].overruns++;
+		}
+		return true;
+	}
+
+	// Finishes the DMA copy to play_buff if it's copying from src, so src can be filled with new data
+	void finish_play_buff_copy_from(const void *src) {
+		if (play_buff_dma.copying_from(src))
+			finish_play_buff_copy();
+	}
+
+	void reset_stream_stats() {
+		for (auto &stats : stream_stats)
+			stats.reset();
+	}
+
+	void log_stream_stats() {
+		for (unsigned i = 0; i < NumSamplesPerBank; i++) {
+			auto &st = stream_stats[i];
+			pr_log("Slot %d: min fill %d, prebuffering %dms, %d underruns, %d overruns, %dkB streamed\n",
+				   i,
+				   st.min_fill == UINT32_MAX ? 0 : st.min_fill,
+				   st.prebuffer_ms,
+				   st.underruns.load(),
+				   st.overruns,
+				   (uint32_t)(st.bytes_streamed >> 10));
+			pr_log("  fill:");
+			for (auto count : st.fill_histogram)
+				pr_log(" %d", count);
+			pr_log("\n");
+		}
+	}
+
 	// GCC_OPTIMIZE_OFF
 	void start_playing() {
 		FRESULT res;
 		float rs;
 
+		finish_play_buff_copy();
+
 		uint8_t samplenum = params.sample;
 		uint8_t banknum = params.bank;
-		Sample *s_sample = &(samples[banknum][samplenum]);
+		Sample *src_sample = &(samples[banknum][samplenum]);
 
-		if (s_sample->filename[0] == 0)
+		if (src_sample->filename[0] == 0)
 			return;
 
 		params.sample_num_now_playing = samplenum;
@@ -196,20 +300,46 @@ public:
 			init_changed_bank();
 		}
 
+		// At high pitches, stream an octave sidecar if one is ready. The level stays fixed until the next start
+		uint8_t octave = 0;
+		if (params.settings.octave_sidecars) {
+			float src_rs = params.pitch * ((float)src_sample->sampleRate / params.settings.record_sample_rate);
+			octave = OctaveSidecar::choose_level(src_rs, sidecars.ready_levels(banknum, samplenum, *src_sample));
+		}
+		bool octave_changed = octave != stream_octave[samplenum];
+		if (octave_changed) {
+			// Don't play from play_buff while we switch files
+			params.play_state = PlayStates::SILENT;
+			stream_octave[samplenum] = octave;
+		}
+		if (octave)
+			sidecar_sample[samplenum] = OctaveSidecarBuilder::sidecar_sample(*src_sample, octave);
+
+		Sample *s_sample = &stream_sample(banknum, samplenum);
+
 		// Reload the sample file if necessary:
 		// Force Reload flag is set (Edit mode, or loaded new index)
 		// File is empty (never been read since entering this bank)
 		// Sample File Changed flag is set (new file was recorded into this slot)
+		// Switched to or from an octave sidecar
+		// File was opened for another bank
 		if (flags.take(Flag::ForceFileReload) || (fil[samplenum].obj.fs == 0) ||
-			(s_sample->file_status == FileStatus::NewFile))
+			(src_sample->file_status == FileStatus::NewFile) || octave_changed || file_bank[samplenum] != banknum)
 		{
 			res = reload_sample_file(&fil[samplenum], s_sample, sd);
+			if (res != FR_OK && octave) {
+				// Fall back to the sample itself if the sidecar can't be opened
+				sidecars.invalidate(samplenum);
+				stream_octave[samplenum] = 0;
+				s_sample = src_sample;
+				res = reload_sample_file(&fil[samplenum], s_sample, sd);
+			}
 			if (res != FR_OK) {
 				g_error |= FILE_OPEN_FAIL;
 				params.play_state = PlayStates::SILENT;
 				return;
 			}
-			s_sample->file_status = FileStatus::Found;
+			src_sample->file_status = FileStatus::Found;
 
 			res = sd.create_linkmap(&fil[samplenum], samplenum);
 			if (res == FR_NOT_ENOUGH_CORE) {
@@ -222,17 +352,10 @@ public:
 				params.play_state = PlayStates::SILENT;
 				return;
 			}
+			file_bank[samplenum] = banknum;
+			cue_pins[samplenum].clear();
 
-			// Check the file is really as long as the sampleSize says it is
-			if (f_size(&fil[samplenum]) < (s_sample->startOfData + s_sample->sampleSize)) {
-				s_sample->sampleSize = f_size(&fil[samplenum]) - s_sample->startOfData;
-
-				if (s_sample->inst_end > s_sample->sampleSize)
-					s_sample->inst_end = s_sample->sampleSize;
-
-				if ((s_sample->inst_start + s_sample->inst_size) > s_sample->sampleSize)
-					s_sample->inst_size = s_sample->sampleSize - s_sample->inst_start;
-			}
+			check_file_size(samplenum, *s_sample);
 
 			cache[samplenum].low = 0;
 			cache[samplenum].high = 0;
@@ -240,7 +363,8 @@ public:
 		}
 
 		// Calculate our actual resampling rate
-		rs = params.pitch * ((float)s_sample->sampleRate / params.settings.record_sample_rate);
+		stream_rate[samplenum] = RateRatio::make(s_sample->sampleRate, params.settings.record_sample_rate);
+		rs = stream_rs(samplenum);
 
 		// Determine starting and ending addresses
 		if (params.settings.use_cues && s_sample->num_cues > 0) {
@@ -265,27 +389,39 @@ public:
 		}
 
 		// See if the starting position is already cached
-		if ((cache[samplenum].high > cache[samplenum].low) && (cache[samplenum].low <= sample_file_startpos) &&
-			(sample_file_startpos <= cache[samplenum].high))
-		{
+		bool cached = (cache[samplenum].high > cache[samplenum].low) && (cache[samplenum].low <= sample_file_startpos) &&
+					  (sample_file_startpos <= cache[samplenum].high);
+		if (cached) {
+			// The audio ISR moves the out ptr and publishes out_count while playing: silence it so the main loop
+			// is the only writer while they're moved. The play state is set to fade up below
+			params.play_state = PlayStates::SILENT;
 			play_buff[samplenum].out = cache[samplenum].map_cache_to_buffer(
 				sample_file_startpos, s_sample->sampleByteSize, &play_buff[samplenum]);
 
-			env_level = 0.f;
-			if (params.length <= 0.5f)
-				params.play_state = params.reverse ? PlayStates::PLAYING_PERC : PlayStates::PERC_FADEUP;
-			else
-				params.play_state = PlayStates::PLAY_FADEUP;
+			// Everything cached between the start position and the loader's end of the cache is ready to play
+			uint32_t cached_ahead = params.reverse ? (sample_file_startpos - cache[samplenum].low) :
+													 (cache[samplenum].high - sample_file_startpos);
+			play_buff[samplenum].resync_counts((cached_ahead * play_bytes(cache[samplenum].format)) /
+											   s_sample->sampleByteSize);
 
 		} else {
 			//...otherwise, start buffering from scratch
 			// Set state to silent so we don't run play_audio_buffer(), which could result in a glitch since the
 			// playbuff and cache values are being changed
 			params.play_state = PlayStates::SILENT;
+			cache[samplenum].format = play_format_for(
+				s_sample->sampleByteSize, params.settings.play_24bits, params.settings.compress_cache);
+			set_play_buff_format(samplenum, cache[samplenum].format, s_sample->numChannels, pins_cues(*s_sample));
 			play_buff[samplenum].init();
 
+			// If the start position is pinned, play the pin while the loader reads on from its end
+			const CuePins::Pin *pin = nullptr;
+			if (!params.reverse && !stream_octave[samplenum] && !(g_error & LSEEK_FPTR_MISMATCH))
+				pin = cue_pins[samplenum].find(sample_file_startpos, cache[samplenum].format);
+			uint32_t pinned = pin ? pin->file_bytes : 0;
+
 			// Seek to the file position where we will start reading
-			sample_file_curpos[samplenum] = sample_file_startpos;
+			sample_file_curpos[samplenum] = sample_file_startpos + pinned;
 			res = set_file_pos(banknum, samplenum);
 
 			// If seeking fails, perhaps we need to reload the file
@@ -316,13 +452,29 @@ public:
 					align_addr(f_tell(&fil[samplenum]) - s_sample->startOfData, s_sample->blockAlign);
 			}
 
+			if (pin && !(g_error & LSEEK_FPTR_MISMATCH))
+				cue_pins[samplenum].restore(*pin, play_buff[samplenum]);
+			else
+				pinned = 0;
+
 			cache[samplenum].low = sample_file_startpos;
-			cache[samplenum].high = sample_file_startpos;
+			cache[samplenum].high = sample_file_startpos + pinned;
 			cache[samplenum].map_pt = play_buff[samplenum].min;
-			cache[samplenum].size = (play_buff[samplenum].size >> 1) * s_sample->sampleByteSize;
-			is_buffered_to_file_end[samplenum] = 0;
+			cache[samplenum].size =
+				(play_buff[samplenum].size / play_bytes(cache[samplenum].format)) * s_sample->sampleByteSize;
+			is_buffered_to_file_end[samplenum] = cache[samplenum].high >= s_sample->inst_end;
 
-			params.play_state = PlayStates::PREBUFFERING;
+			cached = pinned > 0;
+			if (!cached)
+				params.play_state = PlayStates::PREBUFFERING;
+		}
+
+		if (cached) {
+			env_level = 0.f;
+			if (params.length <= 0.5f)
+				params.play_state = params.reverse ? PlayStates::PLAYING_PERC : PlayStates::PERC_FADEUP;
+			else
+				params.play_state = PlayStates::PLAY_FADEUP;
 		}
 
 		// used by toggle_reverse() to see if we hit a reverse trigger right after a play trigger
@@ -354,17 +506,16 @@ public:
 			float length = params.length;
 			uint8_t samplenum = params.sample_num_now_playing;
 			uint8_t banknum = params.sample_bank_now_playing;
-			Sample &s_sample = samples[banknum][samplenum];
+			Sample &s_sample = stream_sample(banknum, samplenum);
 
-			float rs = (s_sample.sampleRate == params.settings.record_sample_rate) ?
-						   params.pitch :
-						   params.pitch * ((float)s_sample.sampleRate / (float)params.settings.record_sample_rate);
+			float rs = stream_rs(samplenum);
 
 			// Amount play_buff[]->out changes with each audio block sent to the codec
-			uint32_t resampled_buffer_size = calc_resampled_buffer_size(s_sample, rs);
+			uint32_t resampled_buffer_size = calc_resampled_buffer_size(s_sample, rs, cache[samplenum].format);
 
 			// Amount an imaginary pointer in the sample file would move with each audio block sent to the codec
-			int32_t resampled_cache_size = calc_resampled_cache_size(s_sample, resampled_buffer_size);
+			int32_t resampled_cache_size =
+				calc_resampled_cache_size(s_sample, resampled_buffer_size, cache[samplenum].format);
 
 			// Amount in the sample file we have remaining before we hit sample_file_endpos
 			// int32_t dist_to_end = calc_dist_to_end(s_sample, banknum);
@@ -394,11 +545,12 @@ public:
 					flags.clear(Flag::ChangePlaytoPerc);
 			} else {
 				// Check if we are about to hit buffer underrun
-				play_buff_bufferedamt[samplenum] = play_buff[samplenum].distance(params.reverse);
+				play_buff_bufferedamt[samplenum] = std::max(play_buff[samplenum].fill(), 0);
 
 				if (!is_buffered_to_file_end[samplenum] && play_buff_bufferedamt[samplenum] <= resampled_buffer_size) {
 					// buffer underrun: tried to read too much out. Try to recover!
 					g_error |= READ_BUFF1_UNDERRUN;
+					stream_stats[samplenum].underruns++;
 					// check_errors();
 					params.play_state = PlayStates::PREBUFFERING;
 				}
@@ -406,14 +558,66 @@ public:
 		}
 	}
 
+	// Loader: sets up an idle slot to prefetch the sample in banknum from startpos, opening its file if it's not open
+	// already. The loader then reads forward from sample_file_curpos into the slot, and start_playing() finds the
+	// start position cached.
+	FRESULT start_prefetch(uint8_t banknum, uint8_t samplenum, uint32_t startpos) {
+		finish_play_buff_copy();
+
+		Sample &s_sample = samples[banknum][samplenum];
+
+		if (fil[samplenum].obj.fs == 0 || file_bank[samplenum] != banknum || stream_octave[samplenum]) {
+			stream_octave[samplenum] = 0;
+			FRESULT res = reload_sample_file(&fil[samplenum], &s_sample, sd);
+			if (res != FR_OK)
+				return res;
+
+			res = sd.create_linkmap(&fil[samplenum], samplenum);
+			if (res != FR_OK && res != FR_NOT_ENOUGH_CORE) {
+				f_close(&fil[samplenum]);
+				return res;
+			}
+			file_bank[samplenum] = banknum;
+			cue_pins[samplenum].clear();
+
+			check_file_size(samplenum, s_sample);
+		}
+
+		cache[samplenum].format =
+			play_format_for(s_sample.sampleByteSize, params.settings.play_24bits, params.settings.compress_cache);
+		set_play_buff_format(samplenum, cache[samplenum].format, s_sample.numChannels, pins_cues(s_sample));
+		play_buff[samplenum].init();
+
+		cache[samplenum].low = startpos;
+		cache[samplenum].high = startpos;
+		cache[samplenum].map_pt = play_buff[samplenum].min;
+		cache[samplenum].size =
+			(play_buff[samplenum].size / play_bytes(cache[samplenum].format)) * s_sample.sampleByteSize;
+		is_buffered_to_file_end[samplenum] = 0;
+		cached_rev_state[samplenum] = 0;
+
+		sample_file_curpos[samplenum] = startpos;
+		return set_file_pos(banknum, samplenum);
+	}
+
+	// Whether the cue pins of a slot can be filled: its file is open for banknum at octave 0, and its play_buff
+	// window leaves the pin area free
+	bool cue_pins_ready(uint8_t banknum, uint8_t samplenum) const {
+		return fil[samplenum].obj.fs && file_bank[samplenum] == banknum && !stream_octave[samplenum] &&
+			   play_buff[samplenum].max <= play_buff[samplenum].min + PlayBuffSlotSize - CuePins::ReservedBytes;
+	}
+
 	FRESULT set_file_pos(uint8_t b, uint8_t s) {
-		FRESULT r = f_lseek(&fil[s], samples[b][s].startOfData + sample_file_curpos[s]);
-		if (fil[s].fptr != (samples[b][s].startOfData + sample_file_curpos[s]))
+		uint32_t startOfData = stream_sample(b, s).startOfData;
+		FRESULT r = f_lseek(&fil[s], startOfData + sample_file_curpos[s]);
+		if (fil[s].fptr != (startOfData + sample_file_curpos[s]))
 			g_error |= LSEEK_FPTR_MISMATCH;
 		return r;
 	}
 
 	void reverse_file_positions(uint8_t samplenum, uint8_t banknum, bool new_dir) {
+		finish_play_buff_copy();
+
 		// Swap sample_file_curpos with cache_high or _low
 		// and move ->in to the equivalant address in play_buff
 		// This gets us ready to read new data to the opposite end of the cache.
@@ -423,9 +627,11 @@ public:
 		} else {
 			sample_file_curpos[samplenum] = cache[samplenum].high;
 			play_buff[samplenum].in = cache[samplenum].map_cache_to_buffer(
-				cache[samplenum].high, samples[banknum][samplenum].sampleByteSize, &play_buff[samplenum]);
+				cache[samplenum].high, stream_sample(banknum, samplenum).sampleByteSize, &play_buff[samplenum]);
 		}
 
+		play_buff[samplenum].resync_counts(play_buff[samplenum].distance(new_dir));
+
 		// Swap the endpos with the startpos
 		// This way, curpos is always moving towards endpos and away from startpos
 		std::swap(sample_file_endpos, sample_file_startpos);
@@ -441,6 +647,39 @@ public:
 	}
 
 private:
+	// Check the file is really as long as the sampleSize says it is
+	void check_file_size(uint8_t samplenum, Sample &s_sample) {
+		if (f_size(&fil[samplenum]) < (s_sample.startOfData + s_sample.sampleSize)) {
+			s_sample.sampleSize = f_size(&fil[samplenum]) - s_sample.startOfData;
+
+			if (s_sample.inst_end > s_sample.sampleSize)
+				s_sample.inst_end = s_sample.sampleSize;
+
+			if ((s_sample.inst_start + s_sample.inst_size) > s_sample.sampleSize)
+				s_sample.inst_size = s_sample.sampleSize - s_sample.inst_start;
+		}
+	}
+
+	// Cue pins are kept for samples with cues, when playing with cues
+	bool pins_cues(const Sample &s_sample) const { return params.settings.use_cues && s_sample.num_cues > 0; }
+
+	// ADPCM addresses play_buff as 16-bit samples, so it needs a larger address range over the same memory.
+	// With pin_cues set, the window leaves room for the cue pins at the end of the slot's memory, otherwise
+	// it uses all of it and the pins are emptied. ADPCM play buffers don't keep cue pins.
+	void set_play_buff_format(uint8_t samplenum, PlayFormat format, uint32_t channels, bool pin_cues) {
+		if (format == PlayFormat::Adpcm)
+			adpcm[samplenum].configure(play_buff[samplenum], PlayBuffSlotSize, channels);
+		else {
+			uint32_t size = whole_frame_bytes(
+				pin_cues ? PlayBuffSlotSize - CuePins::ReservedBytes : PlayBuffSlotSize, format, channels);
+			play_buff[samplenum].max = play_buff[samplenum].min + size;
+			play_buff[samplenum].size = size;
+			play_buff[samplenum].adpcm = nullptr;
+		}
+		if (format == PlayFormat::Adpcm || !pin_cues)
+			cue_pins[samplenum].clear();
+	}
+
 	void toggle_reverse() {
 		uint8_t samplenum, banknum;
 
@@ -472,7 +711,7 @@ private:
 				// See if the endpos is within the cache, then we can just play from that point
 				if ((sample_file_endpos >= cache[samplenum].low) && (sample_file_endpos <= cache[samplenum].high)) {
 					play_buff[samplenum].out = cache[samplenum].map_cache_to_buffer(
-						sample_file_endpos, samples[banknum][samplenum].sampleByteSize, &play_buff[samplenum]);
+						sample_file_endpos, stream_sample(banknum, samplenum).sampleByteSize, &play_buff[samplenum]);
 				} else {
 					// Otherwise we have to make a new cache, so run start_playing()
 					params.reverse = !params.reverse;
@@ -542,12 +781,20 @@ private:
 		uint8_t samplenum;
 		FRESULT res;
 
+		finish_play_buff_copy();
+
 		for (samplenum = 0; samplenum < NUM_SAMPLES_PER_BANK; samplenum++) {
+			// Keep what the loader prefetched from the new bank
+			if (fil[samplenum].obj.fs && file_bank[samplenum] == params.sample_bank_now_playing)
+				continue;
+
 			res = f_close(&fil[samplenum]);
 			if (res != FR_OK)
 				fil[samplenum].obj.fs = 0;
+			cue_pins[samplenum].clear();
 
 			is_buffered_to_file_end[samplenum] = 0;
+			stream_octave[samplenum] = 0;
 
 			play_buff[samplenum].init();
 		}
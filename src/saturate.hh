@@ -0,0 +1,21 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+
+#if defined(ARM_MATH_CM7) || defined(CORE_CA7)
+#include "drivers/stm32xx.h"
+#endif
+
+namespace SamplerKit
+{
+
+// Signed saturation to 24 bits: SSAT on the hardware targets, plain C elsewhere (host tests)
+inline int32_t ssat24(int32_t x) {
+#if defined(ARM_MATH_CM7) || defined(CORE_CA7)
+	return __SSAT(x, 24);
+#else
+	return std::clamp(x, -(1 << 23), (1 << 23) - 1);
+#endif
+}
+
+} // namespace SamplerKit
@@ -27,6 +27,9 @@ enum class RecStates {
 
 enum class AutoStopMode { Off = 0, Always = 1, Looping = 2 };
 
+// Standard: 4-point Hermite interpolation. High: windowed-sinc (ResampleConf::SincTaps taps)
+enum class ResampleQuality { Standard = 0, High = 1 };
+
 struct UserSettings {
 	// These are stored on SD Card
 	// And changed with button-combos or in system mode
@@ -45,6 +48,17 @@ struct UserSettings {
 
 	bool use_cues = false;
 
+	// Stream decimated copies of long samples at high pitches
+	bool octave_sidecars = false;
+
+	ResampleQuality resample_quality = ResampleQuality::Standard;
+
+	// Keep 24-bit and 32-bit samples as 24-bit in the play buffer (less cache per sample than 16-bit)
+	bool play_24bits = false;
+
+	// Keep 16-bit and longer samples as 4-bit ADPCM in the play buffer (more cache per sample, some added noise)
+	bool compress_cache = false;
+
 	// calculated values (formerly in global_params)
 	// Might move them to Sampler class?
 	float play_trig_delay;
@@ -0,0 +1,98 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <span>
+
+namespace SamplerKit
+{
+
+// Single-producer single-consumer byte ring in a fixed block of memory.
+//
+// The write and read positions are free-running byte counts. The fill level is their difference,
+// so it is exact at every level (including empty and full), and the address of a position is
+// base + (pos & mask). The size must be a power of two.
+//
+// The producer writes the data and then publishes its position with a release store. The consumer
+// loads it with acquire before reading the data, and frees the space the same way in the other direction.
+// The recorder uses one: the audio ISR produces, and the main loop drains it to the SD card.
+class SpscRing {
+public:
+	void init(uint32_t base_addr, uint32_t size_bytes) {
+		base = base_addr;
+		mask = size_bytes - 1;
+		wr.store(0, std::memory_order_relaxed);
+		rd.store(0, std::memory_order_release);
+	}
+
+	uint32_t size() const { return mask + 1; }
+
+	// Producer: bytes that can be pushed
+	uint32_t space() const {
+		return size() - (wr.load(std::memory_order_relaxed) - rd.load(std::memory_order_acquire));
+	}
+
+	// Producer: copies bytes into the ring and publishes them.
+	// Returns false and writes nothing if there is not enough space
+	bool push(const void *src, uint32_t bytes) {
+		uint32_t pos = wr.load(std::memory_order_relaxed);
+		if (size() - (pos - rd.load(std::memory_order_acquire)) < bytes)
+			return false;
+
+		auto *s = static_cast<const uint8_t *>(src);
+		uint32_t first = std::min(bytes, size() - (pos & mask));
+		std::memcpy(addr(pos), s, first);
+		std::memcpy(addr(pos + first), s + first, bytes - first);
+
+		wr.store(pos + bytes, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer: bytes that can be read
+	uint32_t available() const {
+		return wr.load(std::memory_order_acquire) - rd.load(std::memory_order_relaxed);
+	}
+
+	// Consumer: read rd_buff.size() 16-bit values, and free the space.
+	// Pads rd_buff with 0's if the ring underflows, and returns the number of samples padded
+	uint32_t memory_read16(std::span<int16_t> rd_buff) {
+		return read(std::as_writable_bytes(rd_buff), 2) / 2;
+	}
+
+	uint32_t memory_read16(int16_t *rd_buff, uint32_t num_samples) { return memory_read16({rd_buff, num_samples}); }
+
+	// Consumer: read packed 24-bit values to fill rd_buff (size must be a multiple of 3), and free the space.
+	// Pads rd_buff with 0's if the ring underflows, and returns the number of samples padded
+	uint32_t memory_read24(std::span<uint8_t> rd_buff) { return read(std::as_writable_bytes(rd_buff), 3) / 3; }
+
+	uint32_t memory_read24(uint8_t *rd_buff, uint32_t num_samples) { return memory_read24({rd_buff, num_samples * 3}); }
+
+	// Consumer: copies whole samples of sample_bytes each into dst, in at most two runs split at the end of
+	// memory, and frees the space. Zero-fills the rest of dst if the ring underflows.
+	// Returns the number of bytes zero-filled
+	uint32_t read(std::span<std::byte> dst, uint32_t sample_bytes) {
+		uint32_t pos = rd.load(std::memory_order_relaxed);
+		uint32_t avail = available();
+		uint32_t bytes = std::min<uint32_t>(dst.size(), avail - avail % sample_bytes);
+
+		uint32_t first = std::min(bytes, size() - (pos & mask));
+		std::memcpy(dst.data(), addr(pos), first);
+		std::memcpy(dst.data() + first, addr(pos + first), bytes - first);
+		std::memset(dst.data() + bytes, 0, dst.size() - bytes);
+
+		rd.store(pos + bytes, std::memory_order_release);
+		return dst.size() - bytes;
+	}
+
+private:
+	uint8_t *addr(uint32_t pos) const { return reinterpret_cast<uint8_t *>(base + (pos & mask)); }
+
+	uint32_t base = 0;
+	uint32_t mask = 0;
+	std::atomic<uint32_t> wr = 0;
+	std::atomic<uint32_t> rd = 0;
+};
+
+} // namespace SamplerKit
@@ -0,0 +1,56 @@
+#pragma once
+#include "drivers/stm32xx.h"
+#include <cstdint>
+#include <cstring>
+
+namespace SamplerKit
+{
+
+// Memory-to-memory copies on DMA2, shared by the F723 and F746 targets.
+// Only DMA2 can do memory-to-memory on the F7 (and the F723 has no DMA2D). Stream 7 is used because the brainboard
+// libs already take DMA2 streams 0, 1, 2 and 4 for the ADCs and the codec, and 7 is free on both boards.
+// The data cache is off (see system_target.hh), so no cache maintenance is needed around a transfer.
+// Transfers are by halfword, since play buffer addresses are only 2-byte aligned.
+struct DmaCopy {
+	static void init() {
+		RCC->AHB1ENR |= RCC_AHB1ENR_DMA2EN;
+		[[maybe_unused]] volatile uint32_t delay = RCC->AHB1ENR;
+		DMA2_Stream7->CR = 0;
+	}
+
+	// bytes must be even, and at most 131070
+	static void start(const void *src, void *dst, uint32_t bytes) {
+		last = {src, dst, bytes};
+		while (DMA2_Stream7->CR & DMA_SxCR_EN)
+			;
+		DMA2->HIFCR = DMA_HIFCR_CTCIF7 | DMA_HIFCR_CHTIF7 | DMA_HIFCR_CTEIF7 | DMA_HIFCR_CDMEIF7 | DMA_HIFCR_CFEIF7;
+		DMA2_Stream7->PAR = reinterpret_cast<uint32_t>(src);
+		DMA2_Stream7->M0AR = reinterpret_cast<uint32_t>(dst);
+		DMA2_Stream7->NDTR = bytes / 2;
+		DMA2_Stream7->FCR = DMA_SxFCR_DMDIS | DMA_SxFCR_FTH;
+		DMA2_Stream7->CR = DMA_SxCR_DIR_1 | DMA_SxCR_PINC | DMA_SxCR_MINC | DMA_SxCR_PSIZE_0 | DMA_SxCR_MSIZE_0 |
+						   DMA_SxCR_PL_0 | DMA_SxCR_EN;
+	}
+
+	// The stream disables itself when the transfer completes, or on an error.
+	// After an error the copy is done with the CPU instead
+	static bool busy() {
+		if (DMA2_Stream7->CR & DMA_SxCR_EN)
+			return true;
+		if (DMA2->HISR & (DMA_HISR_TEIF7 | DMA_HISR_DMEIF7)) {
+			DMA2->HIFCR = DMA_HIFCR_CTEIF7 | DMA_HIFCR_CDMEIF7;
+			std::memcpy(last.dst, last.src, last.bytes);
+		}
+		return false;
+	}
+
+private:
+	struct Transfer {
+		const void *src;
+		void *dst;
+		uint32_t bytes;
+	};
+	static inline Transfer last{};
+};
+
+} // namespace SamplerKit
@@ -0,0 +1,67 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace SamplerKit
+{
+
+// Streaming health of one play buffer slot, for sizing BASE_BUFFER_THRESHOLD and READ_BLOCK_SIZE.
+// The loader records the fill level each time it services the slot, and the times it spends prebuffering.
+// Underruns are counted by the audio ISR, and overruns and bytes streamed by the loader.
+// The main loop logs and resets them (see Flag::LogStreamStats), so the ISR's counter is atomic.
+struct StreamStats {
+	static constexpr uint32_t NumFillBins = 16;
+
+	// Lowest fill level seen by the loader while playing, in play buffer bytes
+	uint32_t min_fill = UINT32_MAX;
+
+	// Total time spent in PREBUFFERING, in ms
+	uint32_t prebuffer_ms = 0;
+
+	std::atomic<uint32_t> underruns = 0;
+	uint32_t overruns = 0;
+
+	// Bytes read from the sample file into the play buffer
+	uint64_t bytes_streamed = 0;
+
+	// Loader services by fill level: bin n counts fill levels from n/16 up to (n+1)/16 of the play buffer.
+	// A full (or overrun) buffer counts in the last bin
+	std::array<uint32_t, NumFillBins> fill_histogram{};
+
+	// Loader: records the fill level of a play buffer of size bytes. Only fill levels seen while playing
+	// count towards min_fill, since the buffer starts out empty
+	void record_fill(uint32_t fill, uint32_t size, bool playing) {
+		uint32_t bin = size ? (uint32_t)(((uint64_t)fill * NumFillBins) / size) : 0;
+		fill_histogram[std::min(bin, NumFillBins - 1)]++;
+		if (playing)
+			min_fill = std::min(min_fill, fill);
+	}
+
+	// Loader: tracks time spent prebuffering, given the time now (ms) and whether the slot is prebuffering
+	void record_prebuffering(uint32_t now_ms, bool prebuffering) {
+		if (prebuffering && !in_prebuffer)
+			prebuffer_start_ms = now_ms;
+		else if (!prebuffering && in_prebuffer)
+			prebuffer_ms += now_ms - prebuffer_start_ms;
+		in_prebuffer = prebuffering;
+	}
+
+	void reset() {
+		min_fill = UINT32_MAX;
+		prebuffer_ms = 0;
+		underruns.store(0);
+		overruns = 0;
+		bytes_streamed = 0;
+		fill_histogram = {};
+		prebuffer_start_ms = 0;
+		in_prebuffer = false;
+	}
+
+private:
+	uint32_t prebuffer_start_ms = 0;
+	bool in_prebuffer = false;
+};
+
+} // namespace SamplerKit
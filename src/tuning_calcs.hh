@@ -38,6 +38,14 @@ inline uint32_t apply_tracking_compensation(int32_t cv_adcval, float cal_amt) {
 	return std::clamp<int32_t>(cv_adcval, 0, 4095);
 }
 
+//
+// Whether a pitch plays a sample untransposed: the pitch pot in its center detent with no pitch CV, or within
+// a cent of that. Pitch is a product of two float lookups, so it isn't compared with 1.0 exactly
+constexpr float UnityPitchTolerance = 0.0005f;
+inline bool is_unity_pitch(float pitch) {
+	return pitch > 1.f - UnityPitchTolerance && pitch < 1.f + UnityPitchTolerance;
+}
+
 //
 // Returns a semitone-quantized tuning amount, given an ADC value
 //
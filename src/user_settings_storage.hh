@@ -29,6 +29,10 @@ struct UserSettingsStorage {
 		FadeUpDownTime,
 		AutoIncRecSlot,
 		UseCues,
+		OctaveSidecars,
+		ResampleQualitySetting,
+		Play24Bits,
+		CompressCache,
 	};
 
 	UserSettingsStorage(Sdcard &sd, Flags &flags)
@@ -58,6 +62,10 @@ struct UserSettingsStorage {
 		settings.fade_time_ms = 24;
 		settings.auto_inc_slot_num_after_rec_trig = false;
 		settings.use_cues = false;
+		settings.octave_sidecars = false;
+		settings.resample_quality = ResampleQuality::Standard;
+		settings.play_24bits = false;
+		settings.compress_cache = false;
 	}
 
 	FRESULT save_user_settings() {
@@ -112,6 +120,18 @@ struct UserSettingsStorage {
 				 "(0 is actually 0.36ms, and 255 is 255ms. Default is 24)\n");
 		f_printf(&settings_file, "## [AUTO INCREMENT REC SLOT ON TRIG] can be \"Yes\" or \"No\" (default)\n");
 		f_printf(&settings_file, "## [USE CUES] can be \"Yes\" or \"No\" (default)\n");
+		f_printf(&settings_file,
+				 "## [OCTAVE SIDECARS] can be \"Yes\" or \"No\" (default). \"Yes\" builds half, quarter and eighth rate "
+				 "copies of long samples in the _STS.system folder, which are played at high pitches\n");
+		f_printf(&settings_file,
+				 "## [RESAMPLE QUALITY] can be \"High\" or \"Standard\" (default). \"High\" uses a windowed-sinc filter "
+				 "when changing pitch or playing samples that are not 48k\n");
+		f_printf(&settings_file,
+				 "## [24-BIT PLAYBACK] can be \"Yes\" or \"No\" (default). \"Yes\" plays 24-bit and 32-bit samples at "
+				 "24-bit resolution, but caches less of each sample than \"No\", which plays them at 16-bit\n");
+		f_printf(&settings_file,
+				 "## [COMPRESSED CACHE] can be \"Yes\" or \"No\" (default). \"Yes\" caches 16-bit and longer samples "
+				 "as 4-bit ADPCM, which holds over three times as much of each sample but adds some noise\n");
 		f_printf(&settings_file, "##\n");
 		f_printf(&settings_file, "## Deleting this file will restore default settings\n");
 		f_printf(&settings_file, "##\n\n");
@@ -218,6 +238,22 @@ struct UserSettingsStorage {
 		f_printf(&settings_file, "[USE CUES]\n");
 		f_printf(&settings_file, "%s\n\n", settings.use_cues ? "Yes" : "No");
 
+		// Write Octave Sidecars setting
+		f_printf(&settings_file, "[OCTAVE SIDECARS]\n");
+		f_printf(&settings_file, "%s\n\n", settings.octave_sidecars ? "Yes" : "No");
+
+		// Write Resample Quality setting
+		f_printf(&settings_file, "[RESAMPLE QUALITY]\n");
+		f_printf(&settings_file, "%s\n\n", settings.resample_quality == ResampleQuality::High ? "High" : "Standard");
+
+		// Write 24-bit Playback setting
+		f_printf(&settings_file, "[24-BIT PLAYBACK]\n");
+		f_printf(&settings_file, "%s\n\n", settings.play_24bits ? "Yes" : "No");
+
+		// Write Compressed Cache setting
+		f_printf(&settings_file, "[COMPRESSED CACHE]\n");
+		f_printf(&settings_file, "%s\n\n", settings.compress_cache ? "Yes" : "No");
+
 		res = f_close(&settings_file);
 
 		return res;
@@ -327,6 +363,26 @@ struct UserSettingsStorage {
 					cur_setting_found = UseCues;
 					continue;
 				}
+
+				if (str_startswith_nocase(read_buffer, "[OCTAVE SIDECARS")) {
+					cur_setting_found = OctaveSidecars;
+					continue;
+				}
+
+				if (str_startswith_nocase(read_buffer, "[RESAMPLE QUALITY")) {
+					cur_setting_found = ResampleQualitySetting;
+					continue;
+				}
+
+				if (str_startswith_nocase(read_buffer, "[24-BIT PLAYBACK")) {
+					cur_setting_found = Play24Bits;
+					continue;
+				}
+
+				if (str_startswith_nocase(read_buffer, "[COMPRESSED CACHE")) {
+					cur_setting_found = CompressCache;
+					continue;
+				}
 			}
 
 			// Look for setting values
@@ -463,6 +519,31 @@ struct UserSettingsStorage {
 
 				cur_setting_found = NoSetting; // back to looking for headers
 			}
+
+			if (cur_setting_found == OctaveSidecars) {
+				settings.octave_sidecars = (str_startswith_nocase(read_buffer, "Yes")) ? 1 : 0;
+
+				cur_setting_found = NoSetting; // back to looking for headers
+			}
+
+			if (cur_setting_found == ResampleQualitySetting) {
+				settings.resample_quality =
+					str_startswith_nocase(read_buffer, "High") ? ResampleQuality::High : ResampleQuality::Standard;
+
+				cur_setting_found = NoSetting; // back to looking for headers
+			}
+
+			if (cur_setting_found == Play24Bits) {
+				settings.play_24bits = (str_startswith_nocase(read_buffer, "Yes")) ? 1 : 0;
+
+				cur_setting_found = NoSetting; // back to looking for headers
+			}
+
+			if (cur_setting_found == CompressCache) {
+				settings.compress_cache = (str_startswith_nocase(read_buffer, "Yes")) ? 1 : 0;
+
+				cur_setting_found = NoSetting; // back to looking for headers
+			}
 		}
 
 		res = f_close(&settings_file);
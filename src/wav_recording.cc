@@ -29,7 +29,6 @@
 #include "wav_recording.hh"
 #include "bank.hh"
 #include "brain_conf.hh"
-#include "circular_buffer.hh"
 #include "elements.hh"
 #include "errors.hh"
 #include "params.hh"
@@ -37,17 +36,15 @@
 #include "sts_filesystem.hh"
 #include "wavefmt.hh"
 #include <array>
+#include <bit>
+#include <cstring>
 
 namespace SamplerKit
 {
 
 void Recorder::init_rec_buff(void) {
-	rec_buff.in = Brain::MemoryStartAddr;
-	rec_buff.out = Brain::MemoryStartAddr;
-	rec_buff.min = Brain::MemoryStartAddr;
-	rec_buff.max = Brain::MemoryEndAddr;
-	rec_buff.size = Brain::MemorySizeBytes; // TODO: bytes or samples?
-	rec_buff.wrapping = 0;
+	// The ring size must be a power of two, which is all of the memory on f723/f746 (8MB), and 128MB of 175MB on mp153
+	rec_buff.init(Brain::MemoryStartAddr, std::bit_floor(Brain::MemorySizeBytes));
 
 	sample_num_to_record_in = params.sample;
 }
@@ -81,10 +78,12 @@ void Recorder::record_audio_to_buffer(const AudioStreamConf::AudioInBlock &src)
 		// if (WATCH_REC_BUFF == 0)
 		// 	{DEBUG0_ON;DEBUG0_OFF;}
 
-		uint32_t overrun = 0;
+		// Largest block: 24-bit stereo
+		std::array<uint8_t, AudioStreamConf::BlockSize * 2 * 3> block;
+		uint32_t num_bytes = 0;
 
-		// Copy a buffer's worth of samples from codec (src) into rec_buff
-		for (auto [i, in] : enumerate(src)) {
+		// Copy a buffer's worth of samples from codec (src) into block
+		for (auto in : src) {
 			for (unsigned chan = 0; chan < 2; chan++) {
 
 				// 1 - chan: Fix for hardware having L/R channels reversed on the inputs
@@ -95,36 +94,20 @@ void Recorder::record_audio_to_buffer(const AudioStreamConf::AudioInBlock &src)
 				scaled = __SSAT(scaled, 24);
 
 				if (params.settings.rec_24bits) {
-					uint8_t bottombyte = scaled & 0x0000FF;
-					uint8_t midbyte = (scaled & 0x00FF00) >> 8;
-					uint8_t topbyte = (scaled & 0xFF0000) >> 16;
-
-					*(uint8_t *)rec_buff.in = bottombyte;
-					rec_buff.offset_in_address(1, 0);
-					rec_buff.wait_memory_ready();
-
-					*(uint8_t *)rec_buff.in = midbyte;
-					rec_buff.offset_in_address(1, 0);
-					rec_buff.wait_memory_ready();
-
-					*(uint8_t *)rec_buff.in = topbyte;
-					rec_buff.offset_in_address(1, 0);
-					rec_buff.wait_memory_ready();
+					block[num_bytes++] = scaled & 0x0000FF;
+					block[num_bytes++] = (scaled & 0x00FF00) >> 8;
+					block[num_bytes++] = (scaled & 0xFF0000) >> 16;
 
 				} else {
-					*(int16_t *)rec_buff.in = scaled >> 8;
-					rec_buff.offset_in_address(2, 0);
-					rec_buff.wait_memory_ready();
+					int16_t s16 = scaled >> 8;
+					std::memcpy(&block[num_bytes], &s16, 2);
+					num_bytes += 2;
 				}
 			}
-
-			// Flag a buffer overrun condition if the in and out pointers cross
-			// But, don't consider the heads being crossed if they end at the same place
-			if ((rec_buff.in == rec_buff.out) && i != (AudioStreamConf::BlockSize - 1))
-				overrun = rec_buff.out;
 		}
 
-		if (overrun) {
+		// Append the block to rec_buff, or drop it if the SD card writes have fallen too far behind
+		if (!rec_buff.push(block.data(), num_bytes)) {
 			g_error |= WRITE_BUFF_OVERRUN;
 			check_errors(g_error);
 		}
@@ -405,20 +388,18 @@ void Recorder::write_buffer_to_storage() {
 			break;
 
 		case RECORDING: {
-			// read a block from rec_buff.out
+			// read a block from rec_buff
 
 			// FixMe: Enable load triaging
 			//  if (play_load_triage==0)
-			uint32_t buffer_lead = rec_buff.distance(0);
+			uint32_t buffer_lead = rec_buff.available();
 
 			uint32_t num_underflowed = 0;
 			if (buffer_lead > WRITE_BLOCK_SIZE) {
 				if (sample_bytesize_now_recording == 3)
-					num_underflowed = rec_buff.memory_read24((uint8_t *)rec_buff16, WRITE_BLOCK_SIZE / 3, 0);
+					num_underflowed = rec_buff.memory_read24({(uint8_t *)rec_buff16, WRITE_BLOCK_SIZE});
 				else
-					num_underflowed = rec_buff.memory_read16(rec_buff16, WRITE_BLOCK_SIZE >> 1, 0);
-
-				// WATCH_REC_BUFF_OUT = rec_buff.out;
+					num_underflowed = rec_buff.memory_read16(rec_buff16);
 
 				if (num_underflowed) {
 					g_error |= WRITE_BUFF_OVERRUN;
@@ -486,7 +467,7 @@ void Recorder::write_buffer_to_storage() {
 		case CLOSING_FILE:
 		case CLOSING_FILE_TO_REC_AGAIN: {
 			// See if we have more in the buffer to write
-			uint32_t buffer_lead = rec_buff.distance(0);
+			uint32_t buffer_lead = rec_buff.available();
 
 			if (buffer_lead) {
 				// Write out remaining data in buffer, one WRITE_BLOCK_SIZE at a time
@@ -495,11 +476,9 @@ void Recorder::write_buffer_to_storage() {
 
 				uint32_t num_underflowed = 0;
 				if (sample_bytesize_now_recording == 3)
-					num_underflowed = rec_buff.memory_read24((uint8_t *)rec_buff16, buffer_lead / 3, 0);
+					num_underflowed = rec_buff.memory_read24({(uint8_t *)rec_buff16, buffer_lead / 3 * 3});
 				else
-					num_underflowed = rec_buff.memory_read16(rec_buff16, buffer_lead >> 1, 0);
-
-				// WATCH_REC_BUFF_OUT = rec_buff.out;
+					num_underflowed = rec_buff.memory_read16({rec_buff16, buffer_lead >> 1});
 
 				if (num_underflowed) {
 					g_error |= MATH_ERROR;
@@ -28,10 +28,10 @@
 
 #pragma once
 
-#include "circular_buffer.hh"
 #include "drivers/stm32xx.h"
 #include "ff.h"
 #include "params.hh"
+#include "spsc_ring.hh"
 #include "wavefmt.hh"
 
 namespace SamplerKit
@@ -45,7 +45,7 @@ struct Recorder {
 	Sdcard &sd;
 	BankManager &banks;
 
-	CircularBuffer rec_buff;
+	SpscRing rec_buff;
 
 	uint32_t g_error = 0;
 
@@ -0,0 +1,330 @@
+#include "doctest.h"
+//
+#include "adpcm.hh"
+#include "host_memory.hh"
+#include "resample.hh"
+#include "resample_sinc.hh"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace SamplerKit;
+
+namespace
+{
+constexpr uint32_t MemSize = 0x2400; // 256 mono or 128 stereo blocks
+constexpr unsigned SincTaps = 16;
+
+// Interleaved 16-bit test signal: a sine on the left, a quieter sine with a step in it on the right
+std::vector<int16_t> test_signal(uint32_t frames, uint32_t channels) {
+	std::vector<int16_t> v(frames * channels);
+	for (uint32_t i = 0; i < frames; i++) {
+		v[i * channels] = (int16_t)(20000.f * std::sin(i * 0.043f));
+		if (channels == 2)
+			v[i * channels + 1] = (int16_t)(6000.f * std::sin(i * 0.29f + 1.f) + ((i / 300) & 1 ? 4000 : -4000));
+	}
+	return v;
+}
+
+double snr_db(const std::vector<int16_t> &ref, const std::vector<int16_t> &test) {
+	double sig = 0, err = 0;
+	for (uint32_t i = 0; i < ref.size(); i++) {
+		sig += (double)ref[i] * ref[i];
+		err += (double)(ref[i] - test[i]) * (ref[i] - test[i]);
+	}
+	return 10 * std::log10(sig / std::max(err, 1.));
+}
+
+// Writes pcm to the store in chunks of chunk_frames, and reads it all back through frame()
+std::vector<int16_t> write_and_read(AdpcmStore &store,
+									CircularBuffer &buf,
+									const std::vector<int16_t> &pcm,
+									uint32_t channels,
+									uint32_t chunk_frames) {
+	const uint32_t frames = pcm.size() / channels;
+	uint32_t published = 0;
+	for (uint32_t pos = 0; pos < frames; pos += chunk_frames) {
+		uint32_t n = std::min(chunk_frames, frames - pos);
+		published += store.write(buf,
+								 reinterpret_cast<const uint8_t *>(&pcm[pos * channels]),
+								 n * channels,
+								 2,
+								 FormatConvert::s16);
+		// Only whole blocks are published until the end
+		CHECK(published == (pos + n) / Adpcm::BlockFrames * Adpcm::decoded_block_bytes(channels));
+	}
+	published += store.flush();
+	CHECK(published == frames * channels * 2);
+
+	std::vector<int16_t> out(pcm.size());
+	for (uint32_t i = 0; i < frames; i++) {
+		const int16_t *f = store.frame(buf.min + i * channels * 2);
+		std::memcpy(&out[i * channels], f, channels * 2);
+	}
+	return out;
+}
+} // namespace
+
+TEST_CASE("ADPCM blocks decode on their own, close to the original") {
+	for (uint32_t channels : {1u, 2u}) {
+		CAPTURE(channels);
+		auto pcm = test_signal(Adpcm::BlockFrames * 20, channels);
+		std::vector<int16_t> out(pcm.size());
+		std::vector<uint8_t> blocks(20 * Adpcm::block_bytes(channels));
+
+		for (uint32_t b = 0; b < 20; b++) {
+			for (uint32_t c = 0; c < channels; c++)
+				Adpcm::encode(&pcm[b * Adpcm::BlockFrames * channels + c],
+							  channels,
+							  &blocks[b * Adpcm::block_bytes(channels) + c * Adpcm::ChannelBytes]);
+		}
+		// Decode in reverse order, so no block depends on the one before it
+		for (uint32_t b = 20; b-- > 0;) {
+			for (uint32_t c = 0; c < channels; c++)
+				Adpcm::decode(&blocks[b * Adpcm::block_bytes(channels) + c * Adpcm::ChannelBytes],
+							  &out[b * Adpcm::BlockFrames * channels + c],
+							  channels);
+		}
+
+		CHECK(snr_db(pcm, out) > 30.);
+		// The first sample of each block is exact
+		for (uint32_t b = 0; b < 20; b++)
+			CHECK(out[b * Adpcm::BlockFrames * channels] == pcm[b * Adpcm::BlockFrames * channels]);
+	}
+
+	CHECK(Adpcm::block_bytes(2) == 72);
+	CHECK(Adpcm::decoded_size(MemSize, 1) == 256 * 128);
+	CHECK(Adpcm::decoded_size(MemSize, 2) == 128 * 256);
+}
+
+TEST_CASE("AdpcmStore reads frames written in chunks that don't line up with the blocks") {
+	HostMemory mem{MemSize};
+	REQUIRE(mem.base);
+
+	for (uint32_t channels : {1u, 2u}) {
+		for (uint32_t chunk : {64u, 1000u, 37u, 5u}) {
+			CAPTURE(channels);
+			CAPTURE(chunk);
+			CircularBuffer buf;
+			mem.attach(buf);
+			AdpcmStore store;
+			store.configure(buf, MemSize, channels);
+			CHECK(buf.size == Adpcm::decoded_size(MemSize, channels));
+			buf.init();
+
+			auto pcm = test_signal(Adpcm::BlockFrames * 100 + 17, channels);
+			auto out = write_and_read(store, buf, pcm, channels, chunk);
+			CHECK(buf.in == buf.min + pcm.size() * 2);
+			CHECK(snr_db(pcm, out) > 30.);
+
+			// Each block is encoded once from all of its frames, so the chunk size makes no difference
+			CircularBuffer whole_buf;
+			HostMemory whole_mem{MemSize};
+			REQUIRE(whole_mem.base);
+			whole_mem.attach(whole_buf);
+			AdpcmStore whole;
+			whole.configure(whole_buf, MemSize, channels);
+			whole_buf.init();
+			CHECK(write_and_read(whole, whole_buf, pcm, channels, pcm.size()) == out);
+
+			// Random access gives the same frames as reading in order
+			for (uint32_t i : {6000u, 3u, 64u, 63u, 5000u, 6416u, 0u, 127u}) {
+				CAPTURE(i);
+				const int16_t *f = store.frame(buf.min + i * channels * 2);
+				CHECK(f[0] == out[i * channels]);
+				if (channels == 2)
+					CHECK(f[1] == out[i * channels + 1]);
+			}
+		}
+	}
+}
+
+TEST_CASE("AdpcmStore wraps on a block boundary, in the 16-bit address space") {
+	HostMemory mem{MemSize};
+	REQUIRE(mem.base);
+	CircularBuffer buf;
+	mem.attach(buf);
+	AdpcmStore store;
+	store.configure(buf, MemSize, 2);
+	buf.init();
+
+	// Start 10 frames before the end, and write past the wrap
+	const uint32_t frame_bytes = 4;
+	buf.in = buf.max - 10 * frame_bytes;
+	auto pcm = test_signal(300, 2);
+	uint32_t published =
+		store.write(buf, reinterpret_cast<const uint8_t *>(pcm.data()), pcm.size(), 2, FormatConvert::s16);
+	CHECK(buf.in == buf.min + 290 * frame_bytes);
+
+	// The 10 frames at the end of the last block are published, since nothing before them will be written.
+	// The 34 frames after the 4 whole blocks from min wait for the next write
+	CHECK(published == (10 + 4 * Adpcm::BlockFrames) * frame_bytes);
+	CHECK(store.flush() == 34 * frame_bytes);
+
+	std::vector<int16_t> out(pcm.size());
+	for (uint32_t i = 0; i < 300; i++) {
+		uint32_t addr = i < 10 ? buf.max - (10 - i) * frame_bytes : buf.min + (i - 10) * frame_bytes;
+		std::memcpy(&out[i * 2], store.frame(addr), frame_bytes);
+	}
+	CHECK(snr_db(pcm, out) > 25.);
+}
+
+TEST_CASE("AdpcmStore never writes a published block again, filling forward or in reverse") {
+	HostMemory mem{MemSize}, ref_mem{MemSize};
+	REQUIRE(mem.base);
+	REQUIRE(ref_mem.base);
+	const uint32_t channels = 2;
+	const uint32_t block_bytes = Adpcm::block_bytes(channels);
+	const uint32_t frame_bytes = 4;
+	const uint32_t frames = Adpcm::BlockFrames * 40;
+	auto pcm = test_signal(frames, channels);
+	auto pcm_at = [&](uint32_t frame) { return reinterpret_cast<const uint8_t *>(&pcm[frame * channels]); };
+
+	CircularBuffer ref;
+	ref_mem.attach(ref);
+	AdpcmStore ref_store;
+	ref_store.configure(ref, MemSize, channels);
+	ref.init();
+	ref_store.write(ref, pcm_at(0), pcm.size(), 2, FormatConvert::s16);
+
+	for (bool reverse : {false, true}) {
+		CAPTURE(reverse);
+		std::memset(mem.base, 0x55, MemSize);
+		CircularBuffer buf;
+		mem.attach(buf);
+		AdpcmStore store;
+		store.configure(buf, MemSize, channels);
+		buf.init();
+
+		std::vector<uint8_t> last(mem.base, mem.base + MemSize);
+		std::vector<bool> published(frames / Adpcm::BlockFrames, false);
+		uint32_t published_bytes = 0;
+		const uint32_t chunk = 37;
+		for (uint32_t done = 0; done < frames;) {
+			uint32_t n = std::min(chunk, frames - done);
+			uint32_t first = reverse ? frames - done - n : done;
+			if (reverse)
+				buf.in = buf.min + first * frame_bytes;
+			published_bytes += store.write(buf, pcm_at(first), n * channels, 2, FormatConvert::s16, reverse);
+			done += n;
+
+			// Published blocks are untouched, and blocks are only published whole
+			for (uint32_t b = 0; b < published.size(); b++) {
+				bool same = std::memcmp(&last[b * block_bytes], mem.base + b * block_bytes, block_bytes) == 0;
+				CHECK((!published[b] || same));
+				if (!same)
+					published[b] = true;
+			}
+			last.assign(mem.base, mem.base + MemSize);
+			CHECK(published_bytes == std::count(published.begin(), published.end(), true) * Adpcm::BlockFrames *
+										 frame_bytes);
+		}
+		CHECK(store.flush() == 0);
+
+		// Every block was encoded once from all its frames, the same as writing it all in one go
+		CHECK(std::memcmp(mem.base, ref_mem.base, published.size() * block_bytes) == 0);
+	}
+}
+
+TEST_CASE("AdpcmStore decodes a block again once it's written, if it was played before") {
+	HostMemory mem{MemSize};
+	REQUIRE(mem.base);
+	std::memset(mem.base, 0, MemSize);
+	CircularBuffer buf;
+	mem.attach(buf);
+	AdpcmStore store;
+	store.configure(buf, MemSize, 1);
+	buf.init();
+
+	// An underrun plays the first block before it's loaded
+	CHECK(store.frame(buf.min)[0] == 0);
+
+	auto pcm = test_signal(Adpcm::BlockFrames, 1);
+	pcm[0] = 1234;
+	store.write(buf, reinterpret_cast<const uint8_t *>(pcm.data()), pcm.size(), 2, FormatConvert::s16);
+	CHECK(store.frame(buf.min)[0] == 1234);
+}
+
+TEST_CASE("Kernels play ADPCM storage the same as 16-bit storage of the decoded audio") {
+	HostMemory mem{MemSize}, ref_mem{Adpcm::decoded_size(MemSize, 2)};
+	REQUIRE(mem.base);
+	REQUIRE(ref_mem.base);
+
+	for (uint32_t channels : {1u, 2u}) {
+		CAPTURE(channels);
+		CircularBuffer buf;
+		mem.attach(buf);
+		AdpcmStore store;
+		store.configure(buf, MemSize, channels);
+		buf.init();
+
+		// Fill the whole buffer, and copy what it decodes to into the 16-bit reference
+		const uint32_t frames = buf.size / (channels * 2);
+		auto decoded = write_and_read(store, buf, test_signal(frames, channels), channels, 1000);
+		std::memcpy(ref_mem.base, decoded.data(), buf.size);
+
+		auto check = [&]<WavChan Chan>(auto &&kernel) {
+			CAPTURE((int)Chan);
+			for (bool rev : {false, true}) {
+				for (float rs : {0.37f, 1.f, 4.7f}) {
+					CAPTURE(rev);
+					CAPTURE(rs);
+					CircularBuffer ref;
+					ref_mem.attach(ref);
+					ref.size = buf.size;
+					ref.max = ref.min + ref.size;
+					buf.init();
+					ResamplerState refL, refR, L, R;
+					SincState<SincTaps> ref_sinc, sinc;
+					std::array<int32_t, 16> refoutL{}, refoutR{}, outL{}, outR{};
+
+					for (unsigned blk = 0; blk < 60; blk++) {
+						bool flush = blk == 0;
+						kernel.template operator()<Chan, PlayFormat::S16>(
+							&ref, refoutL, refoutR, rev, flush, rs, refL, refR, ref_sinc);
+						kernel.template operator()<Chan, PlayFormat::Adpcm>(
+							&buf, outL, outR, rev, flush, rs, L, R, sinc);
+						CHECK(outL == refoutL);
+						CHECK(outR == refoutR);
+						CHECK(buf.out - buf.min == ref.out - ref.min);
+					}
+				}
+			}
+		};
+
+		auto phase = []<WavChan Chan, PlayFormat F>(CircularBuffer *b, auto &oL, auto &oR, bool rev, bool flush,
+													float rs, ResamplerState &l, ResamplerState &r, auto &) {
+			resample_read_phase<Chan, F>(phase_step(rs), b, oL, oR, rev, flush, l, r);
+		};
+		auto sinc = []<WavChan Chan, PlayFormat F>(CircularBuffer *b, auto &oL, auto &oR, bool rev, bool flush,
+												   float rs, ResamplerState &, ResamplerState &, auto &st) {
+			resample_read_sinc<Chan, SincTaps, F>(phase_step(rs), b, oL, oR, rev, flush, st);
+		};
+		auto phase_int = []<WavChan Chan, PlayFormat F>(CircularBuffer *b, auto &oL, auto &oR, bool rev, bool flush,
+														float rs, ResamplerState &l, ResamplerState &r, auto &) {
+			resample_read_phase_int<Chan, F>(phase_step(rs), b, oL, oR, rev, flush, l, r);
+		};
+
+		if (channels == 2) {
+			check.template operator()<WavChan::Stereo>(phase);
+			check.template operator()<WavChan::Average>(sinc);
+			check.template operator()<WavChan::Right>(phase_int);
+			check.template operator()<WavChan::Stereo>(phase_int);
+		} else {
+			check.template operator()<WavChan::Mono>(phase);
+			check.template operator()<WavChan::Mono>(sinc);
+			check.template operator()<WavChan::Mono>(phase_int);
+		}
+	}
+}
+
+TEST_CASE("Compressed cache format is chosen for 16-bit and longer samples") {
+	CHECK(play_format_for(2, false, true) == PlayFormat::Adpcm);
+	CHECK(play_format_for(4, false, true) == PlayFormat::Adpcm);
+	CHECK(play_format_for(3, true, true) == PlayFormat::S24);
+	CHECK(play_format_for(1, false, true) == PlayFormat::S8);
+	CHECK(play_format_for(2, false, false) == PlayFormat::S16);
+	CHECK(play_bytes(PlayFormat::Adpcm) == 2);
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+// Minimal timing helper for the host benchmarks.
+// Runs `fn` (which processes `frames_per_call` frames) repeatedly and prints ns per frame.
+//
+// Environment:
+//   BENCH_CSV=1  print one "suite,case,value,unit" line per result instead of aligned columns
+//   BENCH_MS=n   minimum time to run each case, in ms (default 200)
+namespace Bench
+{
+
+// Keeps the compiler from optimizing away results
+inline void do_not_optimize(const void *p) {
+	asm volatile("" : : "g"(p) : "memory");
+}
+
+inline bool csv_output() {
+	static const bool csv = [] {
+		auto env = getenv("BENCH_CSV");
+		return env && env[0] && env[0] != '0';
+	}();
+	return csv;
+}
+
+inline std::chrono::milliseconds min_time() {
+	static const auto ms = [] {
+		auto env = getenv("BENCH_MS");
+		long ms = env ? atol(env) : 0;
+		return std::chrono::milliseconds(ms > 0 ? ms : 200);
+	}();
+	return ms;
+}
+
+template<typename F>
+double ns_per_frame(uint32_t frames_per_call, F &&fn, std::chrono::milliseconds run_time = min_time()) {
+	using clock = std::chrono::steady_clock;
+
+	// warm up
+	for (unsigned i = 0; i < 1000; i++)
+		fn();
+
+	uint32_t calls = 0;
+	auto start = clock::now();
+	auto elapsed = clock::duration{0};
+	while (elapsed < run_time) {
+		for (unsigned i = 0; i < 1000; i++)
+			fn();
+		calls += 1000;
+		elapsed = clock::now() - start;
+	}
+	double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+	return ns / ((double)calls * frames_per_call);
+}
+
+// Name of the current group of results, used as the first CSV column
+inline const char *suite = "bench";
+
+inline void begin(const char *suite_name) {
+	suite = suite_name;
+	if (!csv_output())
+		printf("== %s ==\n", suite_name);
+}
+
+// In CSV mode, names must not contain commas
+inline void report(const char *name, double ns, const char *unit = "ns/frame") {
+	if (csv_output())
+		printf("%s,%s,%.3f,%s\n", suite, name, ns, unit);
+	else
+		printf("%-40s %8.2f %s\n", name, ns, unit);
+}
+
+} // namespace Bench
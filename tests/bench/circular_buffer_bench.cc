@@ -0,0 +1,109 @@
+#include "bench.hh"
+#include "host_memory.hh"
+#include "spsc_ring.hh"
+#include <array>
+#include <cmath>
+
+// Format converters used by the loader (file data -> play buffer) and the recorder (rec buffer -> file data).
+// Each call converts one READ_BLOCK_SIZE chunk, results are per 16-bit sample written to/read from the buffer.
+
+using namespace SamplerKit;
+
+// Same as READ_BLOCK_SIZE in elements.hh: a multiple of every block size (1, 2, 3, 4, 6, 8 bytes)
+constexpr uint32_t ChunkBytes = 9216;
+
+int main() {
+	Bench::begin("circular_buffer");
+
+	HostMemory mem{0x100000};
+	if (!mem.base) {
+		printf("Could not allocate memory below 4GB\n");
+		return 1;
+	}
+
+	alignas(4) std::array<uint8_t, ChunkBytes> file_data;
+	for (uint32_t i = 0; i < ChunkBytes; i++)
+		file_data[i] = (uint8_t)(i * 37 + (i >> 3));
+	std::array<float, ChunkBytes / 4> float_data;
+	for (uint32_t i = 0; i < float_data.size(); i++)
+		float_data[i] = std::sin(i * 0.01f) * 1.1f;
+
+	CircularBuffer buf;
+	mem.attach(buf);
+
+	for (bool rev : {false, true}) {
+		const char *dir = rev ? "rev" : "fwd";
+		char name[64];
+
+		auto write = [&](const char *conv, uint32_t samples_per_call, auto &&fn) {
+			auto ns = Bench::ns_per_frame(samples_per_call, [&] {
+				buf.init();
+				auto err = fn();
+				Bench::do_not_optimize(&err);
+				Bench::do_not_optimize(mem.base);
+			});
+			snprintf(name, sizeof name, "%s/%s", conv, dir);
+			Bench::report(name, ns, "ns/sample");
+		};
+
+		write("memory_write_16as16", ChunkBytes / 2, [&] {
+			return buf.memory_write_16as16(reinterpret_cast<uint32_t *>(file_data.data()), ChunkBytes / 4, rev);
+		});
+		write("memory_write_24as16", ChunkBytes / 3, [&] {
+			return buf.memory_write_24as16(file_data.data(), ChunkBytes, rev);
+		});
+		write("memory_write_8as16", ChunkBytes, [&] {
+			return buf.memory_write_8as16(file_data.data(), ChunkBytes, rev);
+		});
+		write("memory_write_32ias16", ChunkBytes / 4, [&] {
+			return buf.memory_write_32ias16(file_data.data(), ChunkBytes, rev);
+		});
+		write("memory_write_32fas16", ChunkBytes / 4, [&] {
+			return buf.memory_write_32fas16(float_data.data(), float_data.size(), rev);
+		});
+		write("memory_write16", ChunkBytes / 2, [&] {
+			return buf.memory_write16(reinterpret_cast<int16_t *>(file_data.data()), ChunkBytes / 2, rev);
+		});
+
+		// Reads start far from the in pointer, so they never underflow
+		auto read = [&](const char *conv, uint32_t samples_per_call, auto &&fn) {
+			auto ns = Bench::ns_per_frame(samples_per_call, [&] {
+				buf.init();
+				buf.in = buf.min + buf.size / 2;
+				auto err = fn();
+				Bench::do_not_optimize(&err);
+				Bench::do_not_optimize(file_data.data());
+			});
+			snprintf(name, sizeof name, "%s/%s", conv, dir);
+			Bench::report(name, ns, "ns/sample");
+		};
+
+		read("memory_read16", ChunkBytes / 2, [&] {
+			return buf.memory_read16(reinterpret_cast<int16_t *>(file_data.data()), ChunkBytes / 2, rev);
+		});
+		read("memory_read24", ChunkBytes / 3, [&] {
+			return buf.memory_read24(file_data.data(), ChunkBytes / 3, rev);
+		});
+	}
+
+	// The recorder's path through rec_buff: push one WRITE_BLOCK_SIZE chunk and drain it.
+	// The ring is not reset, so the chunks land at every offset and some wrap
+	SpscRing ring;
+	ring.init(mem.addr(), mem.size);
+	auto push_read = [&](const char *conv, uint32_t samples_per_call, auto &&fn) {
+		auto ns = Bench::ns_per_frame(samples_per_call, [&] {
+			ring.push(file_data.data(), ChunkBytes);
+			auto err = fn();
+			Bench::do_not_optimize(&err);
+			Bench::do_not_optimize(file_data.data());
+		});
+		Bench::report(conv, ns, "ns/sample");
+	};
+	push_read("spsc_ring_push_read16", ChunkBytes / 2, [&] {
+		return ring.memory_read16(reinterpret_cast<int16_t *>(file_data.data()), ChunkBytes / 2);
+	});
+	push_read("spsc_ring_push_read24", ChunkBytes / 3, [&] {
+		return ring.memory_read24(file_data.data(), ChunkBytes / 3);
+	});
+	return 0;
+}
@@ -0,0 +1,85 @@
+#include "bench.hh"
+#include "format_convert.hh"
+#include <array>
+#include <cmath>
+#include <cstring>
+
+// Block format converters vs. the one-sample-at-a-time loops they replaced,
+// converting one READ_BLOCK_SIZE chunk (9216 bytes) per call
+
+using namespace SamplerKit;
+
+constexpr uint32_t ChunkBytes = 9216;
+
+namespace Scalar
+{
+void s24(const uint8_t *in, int16_t *out, uint32_t n) {
+	for (uint32_t i = 0; i < n; i++)
+		out[i] = (int16_t)(in[i * 3 + 2] << 8 | in[i * 3 + 1]);
+}
+
+void s32(const uint8_t *in, int16_t *out, uint32_t n) {
+	for (uint32_t i = 0; i < n; i++)
+		out[i] = (int16_t)(in[i * 4 + 3] << 8 | in[i * 4 + 2]);
+}
+
+void f32(const uint8_t *in, int16_t *out, uint32_t n) {
+	auto *f = reinterpret_cast<const float *>(in);
+	for (uint32_t i = 0; i < n; i++) {
+		if (f[i] >= 1.f)
+			out[i] = 32767;
+		else if (f[i] <= -1.F)
+			out[i] = -32768;
+		else
+			out[i] = (int16_t)(f[i] * 32767.f);
+	}
+}
+
+void u8(const uint8_t *in, int16_t *out, uint32_t n) {
+	for (uint32_t i = 0; i < n; i++)
+		out[i] = ((int16_t)(in[i]) - 128) * 256;
+}
+} // namespace Scalar
+
+int main() {
+	Bench::begin("format_convert");
+
+	alignas(4) std::array<uint8_t, ChunkBytes> in;
+	for (uint32_t i = 0; i < ChunkBytes; i += 4) {
+		float f = std::sin(i * 0.001f) * 1.1f;
+		std::memcpy(&in[i], &f, 4);
+	}
+	std::array<int16_t, ChunkBytes> out;
+
+	const struct {
+		const char *name;
+		uint32_t sample_bytes;
+		FormatConvert::Converter block;
+		FormatConvert::Converter scalar;
+	} formats[] = {
+		{"s24", 3, FormatConvert::s24, Scalar::s24},
+		{"s32", 4, FormatConvert::s32, Scalar::s32},
+		{"f32", 4, FormatConvert::f32, Scalar::f32},
+		{"u8", 1, FormatConvert::u8, Scalar::u8},
+		{"s16", 2, FormatConvert::s16, nullptr},
+	};
+
+	for (auto &f : formats) {
+		const uint32_t num = ChunkBytes / f.sample_bytes;
+		char name[64];
+
+		// Called through a pointer, as the loader does
+		for (auto [kind, convert] : {std::pair{"block", f.block}, std::pair{"scalar", f.scalar}}) {
+			if (!convert)
+				continue;
+			auto ns = Bench::ns_per_frame(num, [&] {
+				Bench::do_not_optimize(in.data());
+				convert(in.data(), out.data(), num);
+				Bench::do_not_optimize(out.data());
+			});
+			snprintf(name, sizeof name, "%s/%s", f.name, kind);
+			Bench::report(name, ns, "ns/sample");
+		}
+	}
+	return 0;
+}
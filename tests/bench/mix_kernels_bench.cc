@@ -0,0 +1,73 @@
+#include "bench.hh"
+#include "mix_kernels.hh"
+#include <array>
+#include <cmath>
+
+using namespace SamplerKit;
+
+constexpr uint32_t BlockSize = 16;
+
+int main() {
+	Bench::begin("mix_kernels");
+
+	std::array<int32_t, BlockSize> L, R, srcL, srcR;
+	std::array<int32_t, BlockSize * 2> out;
+	for (uint32_t i = 0; i < BlockSize; i++) {
+		srcL[i] = 4000000.f * std::sin(i * 0.3f);
+		srcR[i] = 4000000.f * std::cos(i * 0.3f);
+	}
+
+	// Restores the input each call, so the kernels always see the same data and never settle at 0.
+	// The copy is included in the timing, and measured on its own as a baseline
+	auto restore = [&] {
+		L = srcL;
+		R = srcR;
+	};
+
+	Bench::report("copy (baseline)", Bench::ns_per_frame(BlockSize, [&] {
+					  restore();
+					  Bench::do_not_optimize(L.data());
+					  Bench::do_not_optimize(R.data());
+				  }));
+
+	const struct {
+		const char *name;
+		float starting_amp;
+		float rate;
+	} fades[] = {
+		{"fade/up", 0.f, 1.f / 64.f},
+		{"fade/down", 1.f, -1.f / 64.f},
+		{"fade/clamped", 1.f, 1.f / 64.f},
+	};
+	for (auto [name, starting_amp, rate] : fades) {
+		Bench::report(name, Bench::ns_per_frame(BlockSize, [&] {
+						  restore();
+						  float amp = fade(L, R, 0.9f, starting_amp, rate);
+						  Bench::do_not_optimize(&amp);
+						  Bench::do_not_optimize(L.data());
+						  Bench::do_not_optimize(R.data());
+					  }));
+	}
+
+	for (float gain : {0.5f, 3.f}) {
+		char name[64];
+		snprintf(name, sizeof name, "apply_gain/gain=%.2f", gain);
+		Bench::report(name, Bench::ns_per_frame(BlockSize, [&] {
+						  restore();
+						  apply_gain(L, R, gain);
+						  Bench::do_not_optimize(L.data());
+						  Bench::do_not_optimize(R.data());
+					  }));
+	}
+
+	Bench::report("write_stereo_out", Bench::ns_per_frame(BlockSize, [&] {
+					  write_stereo_out(out, srcL, srcR);
+					  Bench::do_not_optimize(out.data());
+				  }));
+
+	Bench::report("write_mono_out", Bench::ns_per_frame(BlockSize, [&] {
+					  write_mono_out(out, srcL);
+					  Bench::do_not_optimize(out.data());
+				  }));
+	return 0;
+}
@@ -0,0 +1,195 @@
+#include "bench.hh"
+#include "host_memory.hh"
+#include "resample.hh"
+#include "resample_sinc.hh"
+#include <array>
+#include <cmath>
+
+using namespace SamplerKit;
+
+constexpr uint32_t BlockSize = 16;
+
+int main() {
+	Bench::begin("resample");
+
+	HostMemory mem{0x100000};
+	if (!mem.base) {
+		printf("Could not allocate memory below 4GB\n");
+		return 1;
+	}
+	auto *p = reinterpret_cast<int16_t *>(mem.base);
+	for (uint32_t i = 0; i < mem.size / 2; i++)
+		p[i] = 20000.f * std::sin(i * 0.013f);
+
+	std::array<int32_t, BlockSize> outL, outR;
+
+	// Stereo phase kernel: one pass over interleaved frames vs a pass per channel
+	for (float rs : {0.5f, 1.f, 1.37f, 4.5f}) {
+		char name[64];
+
+		CircularBuffer buf;
+		mem.attach(buf);
+		ResamplerState left, right;
+		const uint64_t step = phase_step(rs);
+		resample_read_phase<WavChan::Stereo>(step, &buf, outL, outR, false, true, left, right);
+
+		auto two_pass = Bench::ns_per_frame(BlockSize, [&] {
+			uint32_t t = buf.out;
+			uint32_t phase = left.phase;
+			resample_read_phase<WavChan::Left>(step, &buf, outL, false, false, left);
+			buf.out = t;
+			right.phase = phase;
+			resample_read_phase<WavChan::Right>(step, &buf, outR, false, false, right);
+			Bench::do_not_optimize(outL.data());
+			Bench::do_not_optimize(outR.data());
+		});
+		snprintf(name, sizeof name, "stereo two-pass rs=%.2f", rs);
+		Bench::report(name, two_pass);
+
+		auto single_pass = Bench::ns_per_frame(BlockSize, [&] {
+			resample_read_phase<WavChan::Stereo>(step, &buf, outL, outR, false, false, left, right);
+			Bench::do_not_optimize(outL.data());
+			Bench::do_not_optimize(outR.data());
+		});
+		snprintf(name, sizeof name, "stereo single-pass rs=%.2f", rs);
+		Bench::report(name, single_pass);
+	}
+	// Phase accumulator resampler: cost should not depend on the rate
+	for (float rs : {0.5f, 1.f, 1.37f, 4.5f, 20.f, 100.f}) {
+		char name[64];
+
+		CircularBuffer buf;
+		mem.attach(buf);
+		ResamplerState left, right;
+		const uint64_t step = phase_step(rs);
+		resample_read_phase<WavChan::Stereo>(step, &buf, outL, outR, false, true, left, right);
+
+		auto ns = Bench::ns_per_frame(BlockSize, [&] {
+			resample_read_phase<WavChan::Stereo>(step, &buf, outL, outR, false, false, left, right);
+			Bench::do_not_optimize(outL.data());
+			Bench::do_not_optimize(outR.data());
+		});
+		snprintf(name, sizeof name, "stereo phase rs=%.2f", rs);
+		Bench::report(name, ns);
+	}
+	// Integer (packed 16-bit MAC) kernel vs float kernel
+	for (float rs : {0.5f, 1.37f, 4.5f}) {
+		char name[64];
+		const uint64_t step = phase_step(rs);
+
+		for (auto chan : {WavChan::Stereo, WavChan::Mono}) {
+			const char *chan_name = chan == WavChan::Stereo ? "stereo" : "mono";
+			CircularBuffer buf;
+			mem.attach(buf);
+			ResamplerState left, right;
+
+			auto run = [&]<bool Int>() {
+				if (chan == WavChan::Stereo) {
+					if constexpr (Int)
+						resample_read_phase_int<WavChan::Stereo>(step, &buf, outL, outR, false, false, left, right);
+					else
+						resample_read_phase<WavChan::Stereo>(step, &buf, outL, outR, false, false, left, right);
+				} else {
+					if constexpr (Int)
+						resample_read_phase_int<WavChan::Mono>(step, &buf, outL, false, false, left);
+					else
+						resample_read_phase<WavChan::Mono>(step, &buf, outL, false, false, left);
+				}
+				Bench::do_not_optimize(outL.data());
+				Bench::do_not_optimize(outR.data());
+			};
+
+			auto float_ns = Bench::ns_per_frame(BlockSize, [&] { run.operator()<false>(); });
+			snprintf(name, sizeof name, "%s phase float rs=%.2f", chan_name, rs);
+			Bench::report(name, float_ns);
+
+			auto int_ns = Bench::ns_per_frame(BlockSize, [&] { run.operator()<true>(); });
+			snprintf(name, sizeof name, "%s phase int rs=%.2f", chan_name, rs);
+			Bench::report(name, int_ns);
+		}
+	}
+
+	// Untransposed 44.1k and 88.2k playback: rational kernels vs the phase kernels they share history with
+	for (uint32_t sr : {44100u, 88200u}) {
+		char name[64];
+		auto rate = RateRatio::make(sr, 48000);
+		RationalHermiteTable table;
+		table.build(rate);
+		const uint64_t step = phase_step(rate.ratio);
+
+		CircularBuffer buf;
+		mem.attach(buf);
+		ResamplerState left, right;
+		resample_read_phase_int<WavChan::Stereo>(step, &buf, outL, outR, false, true, left, right);
+
+		auto int_ns = Bench::ns_per_frame(BlockSize, [&] {
+			resample_read_phase_int<WavChan::Stereo>(step, &buf, outL, outR, false, false, left, right);
+			Bench::do_not_optimize(outL.data());
+			Bench::do_not_optimize(outR.data());
+		});
+		snprintf(name, sizeof name, "stereo phase int %lu/48k", (unsigned long)sr);
+		Bench::report(name, int_ns);
+
+		auto rational_ns = Bench::ns_per_frame(BlockSize, [&] {
+			resample_read_rational_int<WavChan::Stereo>(table, &buf, outL, outR, false, false, left, right);
+			Bench::do_not_optimize(outL.data());
+			Bench::do_not_optimize(outR.data());
+		});
+		snprintf(name, sizeof name, "stereo rational int %lu/48k", (unsigned long)sr);
+		Bench::report(name, rational_ns);
+
+		// The NEON targets' pair (mp153)
+		resample_read_phase_x4<WavChan::Stereo>(step, &buf, outL, outR, false, true, left, right);
+		auto x4_ns = Bench::ns_per_frame(BlockSize, [&] {
+			resample_read_phase_x4<WavChan::Stereo>(step, &buf, outL, outR, false, false, left, right);
+			Bench::do_not_optimize(outL.data());
+			Bench::do_not_optimize(outR.data());
+		});
+		snprintf(name, sizeof name, "stereo phase x4 %lu/48k", (unsigned long)sr);
+		Bench::report(name, x4_ns);
+
+		auto rational_x4_ns = Bench::ns_per_frame(BlockSize, [&] {
+			resample_read_rational_x4<WavChan::Stereo>(table, &buf, outL, outR, false, false, left, right);
+			Bench::do_not_optimize(outL.data());
+			Bench::do_not_optimize(outR.data());
+		});
+		snprintf(name, sizeof name, "stereo rational x4 %lu/48k", (unsigned long)sr);
+		Bench::report(name, rational_x4_ns);
+	}
+
+	// Cost of one audio block at each quality level, to compare against the audio ISR budget.
+	// Standard is the Hermite kernel (float or int, depending on the target), High is windowed-sinc
+	// with ResampleConf::SincTaps taps (16 on f723/f746, 32 on mp153)
+	{
+		const uint64_t step = phase_step(44100.f / 48000.f);
+		auto per_block = [&](const char *name, auto &&fn) {
+			CircularBuffer buf;
+			mem.attach(buf);
+			fn(buf, true);
+			Bench::report(name, Bench::ns_per_frame(1, [&] {
+				fn(buf, false);
+				Bench::do_not_optimize(outL.data());
+				Bench::do_not_optimize(outR.data());
+			}), "ns/block");
+		};
+		auto sinc = [&]<unsigned Taps>(const char *name) {
+			SincState<Taps> state;
+			per_block(name, [&](CircularBuffer &buf, bool flush) {
+				resample_read_sinc<WavChan::Stereo>(step, &buf, outL, outR, false, flush, state);
+			});
+		};
+
+		ResamplerState left, right;
+		per_block("stereo quality standard float", [&](CircularBuffer &buf, bool flush) {
+			resample_read_phase<WavChan::Stereo>(step, &buf, outL, outR, false, flush, left, right);
+		});
+		per_block("stereo quality standard int", [&](CircularBuffer &buf, bool flush) {
+			resample_read_phase_int<WavChan::Stereo>(step, &buf, outL, outR, false, flush, left, right);
+		});
+		sinc.operator()<8>("stereo quality high 8 taps");
+		sinc.operator()<16>("stereo quality high 16 taps");
+		sinc.operator()<32>("stereo quality high 32 taps");
+		sinc.operator()<64>("stereo quality high 64 taps");
+	}
+	return 0;
+}
@@ -0,0 +1,107 @@
+#include "bench.hh"
+#include "host_memory.hh"
+#include "resample.hh"
+#include <array>
+#include <cmath>
+
+// Every Hermite kernel across the playback parameter space:
+// pitch, channel mode, direction, and whether the history is flushed on each block
+// (which is what happens on the first block after a start, a loop, or a pitch jump)
+
+using namespace SamplerKit;
+
+constexpr uint32_t BlockSize = 16;
+
+enum class Kernel { Phase, PhaseX4, PhaseInt };
+
+template<WavChan Chan>
+void read_block(Kernel kernel,
+				uint64_t step,
+				CircularBuffer *buf,
+				std::span<int32_t> outL,
+				std::span<int32_t> outR,
+				bool rev,
+				bool flush,
+				ResamplerState &left,
+				ResamplerState &right) {
+	switch (kernel) {
+		case Kernel::Phase:
+			resample_read_phase<Chan>(step, buf, outL, outR, rev, flush, left, right);
+			break;
+		case Kernel::PhaseX4:
+			resample_read_phase_x4<Chan>(step, buf, outL, outR, rev, flush, left, right);
+			break;
+		case Kernel::PhaseInt:
+			resample_read_phase_int<Chan>(step, buf, outL, outR, rev, flush, left, right);
+			break;
+	}
+}
+
+int main() {
+	Bench::begin("resample_sweep");
+
+	HostMemory mem{0x100000};
+	if (!mem.base) {
+		printf("Could not allocate memory below 4GB\n");
+		return 1;
+	}
+	auto *p = reinterpret_cast<int16_t *>(mem.base);
+	for (uint32_t i = 0; i < mem.size / 2; i++)
+		p[i] = 20000.f * std::sin(i * 0.013f);
+
+	std::array<int32_t, BlockSize> outL, outR;
+
+	const struct {
+		Kernel kernel;
+		const char *name;
+	} kernels[] = {
+		{Kernel::Phase, "phase"},
+		{Kernel::PhaseX4, "phase_x4"},
+		{Kernel::PhaseInt, "phase_int"},
+	};
+
+	// Shorter runs per case, there are a lot of them
+	const auto run_time = Bench::min_time() / 4;
+
+	for (auto [kernel, kernel_name] : kernels) {
+		for (float rs : {0.1f, 0.25f, 0.5f, 1.f, 1.37f, 2.f, 4.5f, 10.f, 20.f}) {
+			const uint64_t step = phase_step(rs);
+
+			for (bool rev : {false, true}) {
+				for (bool flush : {false, true}) {
+					auto bench = [&]<WavChan Chan>(const char *chan_name) {
+						CircularBuffer buf;
+						mem.attach(buf);
+						ResamplerState left, right;
+						read_block<Chan>(kernel, step, &buf, outL, outR, rev, true, left, right);
+
+						auto ns = Bench::ns_per_frame(
+							BlockSize,
+							[&] {
+								read_block<Chan>(kernel, step, &buf, outL, outR, rev, flush, left, right);
+								Bench::do_not_optimize(outL.data());
+								Bench::do_not_optimize(outR.data());
+							},
+							run_time);
+
+						char name[80];
+						snprintf(name,
+								 sizeof name,
+								 "%s/%s/rs=%.2f/%s/%s",
+								 kernel_name,
+								 chan_name,
+								 rs,
+								 rev ? "rev" : "fwd",
+								 flush ? "flush" : "noflush");
+						Bench::report(name, ns);
+					};
+
+					bench.operator()<WavChan::Mono>("mono");
+					bench.operator()<WavChan::Stereo>("stereo");
+					bench.operator()<WavChan::Average>("average");
+				}
+			}
+		}
+	}
+	return 0;
+}
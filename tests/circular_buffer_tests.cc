@@ -0,0 +1,325 @@
+#include "doctest.h"
+//
+#include "host_memory.hh"
+#include <cstring>
+#include <vector>
+
+using namespace SamplerKit;
+
+namespace
+{
+constexpr uint32_t MemSize = 0x1000;
+
+// Writes one item at a time, and checks whether any item landed on data not yet played
+uint32_t reference_write(CircularBuffer &buf, const std::vector<uint32_t> &items, uint32_t item_bytes, bool decrement) {
+	uint32_t free = buf.size - buf.fill();
+	uint32_t crossed = 0;
+	for (auto item : items) {
+		if (free < item_bytes)
+			crossed = 1;
+		else
+			free -= item_bytes;
+		if (item_bytes == 4)
+			*reinterpret_cast<uint32_t *>(buf.in) = item;
+		else
+			*reinterpret_cast<int16_t *>(buf.in) = (int16_t)item;
+		buf.offset_in_address(item_bytes, decrement);
+	}
+	return crossed;
+}
+
+// in == out is empty, unless full is set
+struct Start {
+	uint32_t in_offset;
+	uint32_t out_offset;
+	bool full;
+};
+
+// Sets the fill level to the bytes between the out and in ptrs, in the direction of play
+void set_fill(CircularBuffer &buf, bool full, bool decrement) {
+	buf.resync_counts(buf.in == buf.out ? (full ? buf.size : 0) : buf.distance(decrement));
+}
+
+// Runs the same write on two buffers, and checks that memory, pointers and the return value match
+template<typename F>
+void check_matches_reference(const std::vector<uint32_t> &expected, uint32_t item_bytes, F &&write) {
+	HostMemory mem{MemSize}, ref_mem{MemSize};
+	REQUIRE(mem.base);
+	REQUIRE(ref_mem.base);
+
+	// Starts at both ends, on the last item before the end, with out just ahead of or behind in, and full
+	const Start starts[] = {
+		{0, 0, false},
+		{0, 0x800, false},
+		{0x100, 0x80, false},
+		{MemSize - 0x40, 0x20, false},
+		{MemSize - item_bytes, MemSize - 0x100, false},
+		{MemSize - 0x40, MemSize - 0x20, false},
+		{0x20, 0x10, false},
+		{item_bytes, 0x400, false},
+		{0x200, 0x200, true},
+	};
+
+	for (auto start : starts) {
+		for (bool decrement : {false, true}) {
+			CAPTURE(start.in_offset);
+			CAPTURE(start.out_offset);
+			CAPTURE(decrement);
+
+			memset(mem.base, 0x55, MemSize);
+			memset(ref_mem.base, 0x55, MemSize);
+			CircularBuffer buf, ref;
+			mem.attach(buf);
+			ref_mem.attach(ref);
+			buf.in = mem.addr() + start.in_offset;
+			buf.out = mem.addr() + start.out_offset;
+			ref.in = ref_mem.addr() + start.in_offset;
+			ref.out = ref_mem.addr() + start.out_offset;
+			set_fill(buf, start.full, decrement);
+			set_fill(ref, start.full, decrement);
+
+			uint32_t err = write(buf, decrement);
+			uint32_t ref_err = reference_write(ref, expected, item_bytes, decrement);
+
+			CHECK(err == ref_err);
+			CHECK(buf.in - mem.addr() == ref.in - ref_mem.addr());
+			CHECK(memcmp(mem.base, ref_mem.base, MemSize) == 0);
+		}
+	}
+}
+} // namespace
+
+TEST_CASE("memory_write_16as16 matches writing one word at a time") {
+	std::vector<uint32_t> words(0x90);
+	for (uint32_t i = 0; i < words.size(); i++)
+		words[i] = 0x10001 * i + 0x12345678;
+
+	check_matches_reference(words, 4, [&](CircularBuffer &buf, bool decrement) {
+		return buf.memory_write_16as16(words.data(), words.size(), decrement);
+	});
+}
+
+TEST_CASE("memory_write converters match writing one sample at a time") {
+	constexpr uint32_t NumSamples = 0x123;
+
+	std::vector<uint8_t> bytes(NumSamples * 4);
+	for (uint32_t i = 0; i < bytes.size(); i++)
+		bytes[i] = (uint8_t)(i * 37 + (i >> 4));
+
+	SUBCASE("24-bit") {
+		std::vector<uint32_t> expected(NumSamples);
+		for (uint32_t i = 0; i < NumSamples; i++)
+			expected[i] = (uint16_t)(bytes[i * 3 + 2] << 8 | bytes[i * 3 + 1]);
+		check_matches_reference(expected, 2, [&](CircularBuffer &buf, bool decrement) {
+			return buf.memory_write_24as16(bytes.data(), NumSamples * 3, decrement);
+		});
+	}
+
+	SUBCASE("32-bit int") {
+		std::vector<uint32_t> expected(NumSamples);
+		for (uint32_t i = 0; i < NumSamples; i++)
+			expected[i] = (uint16_t)(bytes[i * 4 + 3] << 8 | bytes[i * 4 + 2]);
+		check_matches_reference(expected, 2, [&](CircularBuffer &buf, bool decrement) {
+			return buf.memory_write_32ias16(bytes.data(), NumSamples * 4, decrement);
+		});
+	}
+
+	SUBCASE("8-bit") {
+		std::vector<uint32_t> expected(NumSamples);
+		for (uint32_t i = 0; i < NumSamples; i++)
+			expected[i] = (uint16_t)((bytes[i] - 128) * 256);
+		check_matches_reference(expected, 2, [&](CircularBuffer &buf, bool decrement) {
+			return buf.memory_write_8as16(bytes.data(), NumSamples, decrement);
+		});
+	}
+
+	SUBCASE("32-bit float") {
+		std::vector<float> floats(NumSamples);
+		std::vector<uint32_t> expected(NumSamples);
+		for (uint32_t i = 0; i < NumSamples; i++) {
+			floats[i] = (float)i / 100.f - 1.5f;
+			int16_t s = floats[i] >= 1.f ? 32767 : floats[i] <= -1.f ? -32768 : (int16_t)(floats[i] * 32767.f);
+			expected[i] = (uint16_t)s;
+		}
+		check_matches_reference(expected, 2, [&](CircularBuffer &buf, bool decrement) {
+			return buf.memory_write_32fas16(floats.data(), NumSamples, decrement);
+		});
+	}
+}
+
+TEST_CASE("Fill level counts tell a full buffer from an empty one") {
+	HostMemory mem{MemSize};
+	REQUIRE(mem.base);
+	CircularBuffer buf;
+	mem.attach(buf);
+	CHECK(buf.fill() == 0);
+
+	std::vector<uint32_t> words(MemSize / 4, 0x12345678);
+	buf.memory_write_16as16(words.data(), words.size(), false);
+	buf.written(MemSize);
+	CHECK(buf.in == buf.out);
+	CHECK(buf.fill() == (int32_t)MemSize);
+
+	buf.played(0x100);
+	CHECK(buf.fill() == (int32_t)MemSize - 0x100);
+
+	// Playing past the loaded data is an underrun
+	buf.played(MemSize);
+	CHECK(buf.fill() == -0x100);
+
+	buf.resync_counts(0x40);
+	CHECK(buf.fill() == 0x40);
+}
+
+TEST_CASE("A write crosses the out ptr only if it is more than the free space, in either direction") {
+	HostMemory mem{MemSize};
+	REQUIRE(mem.base);
+	std::vector<uint32_t> words(MemSize / 4, 0x12345678);
+
+	for (bool decrement : {false, true}) {
+		CAPTURE(decrement);
+		CircularBuffer buf;
+		mem.attach(buf);
+		buf.in = buf.out = buf.min + 0x100;
+
+		// Empty with in == out: filling the whole buffer does not cross, wrapping on the way
+		CHECK(buf.memory_write_16as16(words.data(), MemSize / 4, decrement) == 0);
+		buf.written(MemSize);
+		CHECK(buf.in == buf.out);
+
+		// Full with in == out: any write crosses
+		CHECK(buf.memory_write_16as16(words.data(), 1, decrement) == 1);
+
+		// Room for 0x40 bytes
+		buf.played(0x44);
+		CHECK(buf.memory_write_16as16(words.data(), 0x10, decrement) == 0);
+		buf.written(0x40);
+		CHECK(buf.memory_write_16as16(words.data(), 2, decrement) == 1);
+	}
+}
+
+TEST_CASE("memory_read16 and memory_read24 match reading one element at a time") {
+	HostMemory mem{MemSize};
+	REQUIRE(mem.base);
+	for (uint32_t i = 0; i < MemSize; i++)
+		mem.base[i] = (uint8_t)(i * 37 + (i >> 4));
+
+	// Start near each end, with in just ahead of out, far from it, and behind it (underflow)
+	const Start starts[] = {
+		{0x800, 0, false},
+		{0x20, MemSize - 0x40, false},
+		{MemSize - 0x10, 0x30, false},
+		{0x31, 0x10, false},
+		{0x10, 0x10, false},
+		{0x300, 0x302, false},
+		{0x300, 0x301, false},
+	};
+
+	for (auto start : starts) {
+		for (bool decrement : {false, true}) {
+			for (uint32_t num : {1u, 7u, 0x50u, 0x3FFu}) {
+				CAPTURE(start.in_offset);
+				CAPTURE(start.out_offset);
+				CAPTURE(decrement);
+				CAPTURE(num);
+
+				auto setup = [&](CircularBuffer &b) {
+					mem.attach(b);
+					b.in = mem.addr() + start.in_offset;
+					b.out = mem.addr() + start.out_offset;
+				};
+				CircularBuffer buf, ref;
+
+				// 16-bit: underflows once the out ptr reaches the in ptr
+				// (The one-at-a-time read steps over an in ptr an odd number of bytes away, so skip those)
+				setup(buf);
+				setup(ref);
+				if (ref.distance(decrement) % 2 == 0) {
+					std::vector<int16_t> out16(num + 1, 0x5555), ref16(num + 1, 0x5555);
+					uint32_t ref_underflowed = 0;
+					for (uint32_t i = 0; i < num; i++) {
+						if (ref.out == ref.in)
+							ref_underflowed = 1;
+						else if (ref_underflowed)
+							ref_underflowed++;
+						ref16[i] = ref_underflowed ? 0 : *reinterpret_cast<int16_t *>(ref.out);
+						ref.offset_out_address(2, decrement);
+						ref.out &= 0xFFFFFFFE;
+					}
+					CHECK(buf.memory_read16(out16.data(), num, decrement) == ref_underflowed);
+					CHECK(out16 == ref16);
+					CHECK(buf.out == ref.out);
+				}
+
+				// 24-bit: bytes backwards when decrementing, and whole samples up to the in ptr
+				setup(buf);
+				setup(ref);
+				std::vector<uint8_t> out24(num * 3 + 1, 0x55), ref24(num * 3 + 1, 0x55);
+				uint32_t avail = ref.distance(decrement) / 3;
+				for (uint32_t i = 0; i < num * 3; i++) {
+					ref24[i] = (i / 3 < avail) ? *reinterpret_cast<uint8_t *>(ref.out) : 0;
+					ref.offset_out_address(1, decrement);
+				}
+				CHECK(buf.memory_read24(out24.data(), num, decrement) == num - std::min(num, avail));
+				CHECK(out24 == ref24);
+				CHECK(buf.out == ref.out);
+			}
+		}
+	}
+}
+
+TEST_CASE("contiguous_in only allows aligned runs that don't wrap") {
+	HostMemory mem{MemSize};
+	REQUIRE(mem.base);
+	CircularBuffer buf;
+	mem.attach(buf);
+
+	CHECK(buf.contiguous_in(MemSize, 4) == buf.min);
+	CHECK(buf.contiguous_in(MemSize + 4, 4) == 0);
+
+	buf.in = buf.min + 0x102;
+	CHECK(buf.contiguous_in(0x10, 4) == 0);
+	CHECK(buf.contiguous_in(0x10, 2) == buf.min + 0x102);
+
+	buf.in = buf.max - 0x100;
+	CHECK(buf.contiguous_in(0x100, 4) == buf.max - 0x100);
+	CHECK(buf.contiguous_in(0x104, 4) == 0);
+}
+
+TEST_CASE("contiguous_before_in only allows aligned runs that end at the in ptr without wrapping") {
+	HostMemory mem{MemSize};
+	REQUIRE(mem.base);
+	CircularBuffer buf;
+	mem.attach(buf);
+
+	CHECK(buf.contiguous_before_in(0x10, 4) == 0);
+
+	buf.in = buf.min + 0x100;
+	CHECK(buf.contiguous_before_in(0x100, 4) == buf.min);
+	CHECK(buf.contiguous_before_in(0x104, 4) == 0);
+	CHECK(buf.contiguous_before_in(0x42, 4) == 0);
+	CHECK(buf.contiguous_before_in(0x42, 2) == buf.min + 0xBE);
+
+	buf.in = buf.max;
+	CHECK(buf.contiguous_before_in(MemSize, 4) == buf.min);
+}
+
+TEST_CASE("room_before_in is limited by the start of the buffer, and by data not yet played") {
+	HostMemory mem{MemSize};
+	REQUIRE(mem.base);
+	CircularBuffer buf;
+	mem.attach(buf);
+
+	CHECK(buf.room_before_in() == 0);
+
+	buf.in = buf.min + 0x800;
+	CHECK(buf.room_before_in() == 0x800);
+
+	// 0xC00 buffered leaves 0x400 free
+	buf.written(0xC00);
+	CHECK(buf.room_before_in() == 0x400);
+
+	// An overrun leaves no room
+	buf.written(0x800);
+	CHECK(buf.room_before_in() == 0);
+}
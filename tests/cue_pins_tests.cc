@@ -0,0 +1,83 @@
+#include "doctest.h"
+//
+#include "cue_pins.hh"
+#include "format_convert.hh"
+#include "host_memory.hh"
+#include <cstring>
+#include <vector>
+
+using namespace SamplerKit;
+
+namespace
+{
+Sample cued_sample() {
+	Sample s{};
+	s.blockAlign = 4;
+	s.sampleByteSize = 2;
+	s.numChannels = 2;
+	s.PCM = 1;
+	s.inst_start = 0x100;
+	s.inst_end = 0x100000;
+	s.num_cues = 3;
+	s.cue[0] = 0x1000; // file position 0x4000
+	s.cue[1] = 0x20;   // before inst_start
+	s.cue[2] = 0x3FFF0;
+	return s;
+}
+} // namespace
+
+TEST_CASE("Pins start at the sample start and at each cue inside the sample") {
+	Sample s = cued_sample();
+	CHECK(CuePins::pin_pos(s, 0) == 0x100);
+	CHECK(CuePins::pin_pos(s, 1) == 0x4000);
+	CHECK(CuePins::pin_pos(s, 2) == CuePins::NoPin);
+	CHECK(CuePins::pin_pos(s, 3) == 0xFFFC0);
+	CHECK(CuePins::pin_pos(s, 4) == CuePins::NoPin);
+
+	CHECK(CuePins::pin_size(s, 0x4000) == CuePins::PinFileBytes);
+	CHECK(CuePins::pin_size(s, 0xFFFC0) == 0x40);
+}
+
+TEST_CASE("A pin written in blocks is restored into a play buffer") {
+	HostMemory mem{CuePins::ReservedBytes + 0x10000};
+	REQUIRE(mem.base);
+
+	CuePins pins;
+	pins.set_base(mem.addr() + 0x10000);
+	CircularBuffer play_buff;
+	play_buff.min = mem.addr();
+	play_buff.max = mem.addr() + 0x10000;
+	play_buff.size = 0x10000;
+	play_buff.init();
+
+	std::vector<int16_t> file(CuePins::PinFileBytes / 2);
+	for (uint32_t i = 0; i < file.size(); i++)
+		file[i] = (int16_t)(i * 31 - 7000);
+
+	pins.start(1, 0x4000, PlayFormat::S16);
+	CHECK(pins.find(0x4000, PlayFormat::S16) == nullptr);
+
+	const uint32_t half = file.size() / 2;
+	for (uint32_t block : {0u, half}) {
+		CircularBuffer pin_buff;
+		pins.attach(1, pin_buff);
+		pin_buff.memory_write_as16((uint8_t *)&file[block], half, 2, FormatConvert::s16, 0);
+		pins.appended(1, half * 2, half * 2);
+	}
+
+	auto *pin = pins.find(0x4000, PlayFormat::S16);
+	REQUIRE(pin);
+	CHECK(pin->file_bytes == CuePins::PinFileBytes);
+	CHECK(pins.find(0x4000, PlayFormat::S24) == nullptr);
+	CHECK(pins.find(0x100, PlayFormat::S16) == nullptr);
+
+	pins.restore(*pin, play_buff);
+	CHECK(play_buff.fill() == (int32_t)CuePins::PinFileBytes);
+	CHECK(play_buff.in == play_buff.min + CuePins::PinFileBytes);
+	CHECK(std::memcmp(mem.base, file.data(), CuePins::PinFileBytes) == 0);
+
+	// Pins in another format are dropped
+	pins.start(0, 0x100, PlayFormat::S24);
+	CHECK(pins.find(0x4000, PlayFormat::S16) == nullptr);
+	CHECK(pins[1].file_bytes == 0);
+}
@@ -0,0 +1,55 @@
+#include "doctest.h"
+//
+#include "file_read_buffers.hh"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace SamplerKit;
+
+TEST_CASE("Reads alternate between the two buffers, so the last block stays intact") {
+	constexpr uint32_t BlockSize = 512;
+
+	FILE *f = tmpfile();
+	REQUIRE(f);
+	std::vector<uint8_t> data(BlockSize * 3 + 100);
+	for (uint32_t i = 0; i < data.size(); i++)
+		data[i] = (uint8_t)(i * 7 + i / 256);
+	fwrite(data.data(), 1, data.size(), f);
+	rewind(f);
+
+	FileReadBuffers<BlockSize> buffers;
+
+	// Each buffer is released before it's filled, so a copy still using it can be finished
+	const uint8_t *released = nullptr;
+	auto release = [&](const uint8_t *buf) {
+		CHECK(buf != released);
+		released = buf;
+	};
+
+	auto a = buffers.read(f, BlockSize, release);
+	CHECK(released == a.data);
+	CHECK(a.res == FR_OK);
+	CHECK(a.bytes_read == BlockSize);
+
+	auto b = buffers.read(f, BlockSize, release);
+	CHECK(released == b.data);
+	CHECK(b.data != a.data);
+	CHECK(std::memcmp(a.data, &data[0], BlockSize) == 0);
+	CHECK(std::memcmp(b.data, &data[BlockSize], BlockSize) == 0);
+
+	auto c = buffers.read(f, BlockSize, release);
+	CHECK(released == c.data);
+	CHECK(c.data == a.data);
+	CHECK(std::memcmp(b.data, &data[BlockSize], BlockSize) == 0);
+	CHECK(std::memcmp(c.data, &data[BlockSize * 2], BlockSize) == 0);
+
+	// A short read at the end of the file
+	auto d = buffers.read(f, BlockSize, release);
+	CHECK(released == d.data);
+	CHECK(d.data == b.data);
+	CHECK(d.bytes_read == 100);
+	CHECK(std::memcmp(d.data, &data[BlockSize * 3], 100) == 0);
+
+	fclose(f);
+}
@@ -0,0 +1,91 @@
+#include "doctest.h"
+//
+#include "format_convert.hh"
+#include <cstring>
+#include <vector>
+
+using namespace SamplerKit;
+
+namespace
+{
+// Checks a converter against a one-sample-at-a-time reference, for lengths that exercise
+// the vector, word and tail loops, with input and output at every alignment
+template<typename Ref>
+void check_converter(FormatConvert::Converter convert, uint32_t sample_bytes, const std::vector<uint8_t> &data, Ref &&ref) {
+	for (uint32_t num : {0u, 1u, 3u, 4u, 5u, 15u, 16u, 17u, 33u, 100u}) {
+		for (uint32_t in_offset : {0u, 1u, 2u, 3u}) {
+			for (uint32_t out_offset : {0u, 1u}) {
+				CAPTURE(num);
+				CAPTURE(in_offset);
+				CAPTURE(out_offset);
+				std::vector<int16_t> out(num + 4, 0x5555);
+				convert(&data[in_offset], &out[out_offset], num);
+
+				CHECK(out[out_offset + num] == 0x5555);
+				for (uint32_t i = 0; i < num; i++)
+					CHECK(out[out_offset + i] == ref(&data[in_offset + i * sample_bytes]));
+			}
+		}
+	}
+}
+
+std::vector<uint8_t> test_bytes() {
+	std::vector<uint8_t> data(100 * 4 + 8);
+	for (uint32_t i = 0; i < data.size(); i++)
+		data[i] = (uint8_t)(i * 37 + (i >> 3) * 11);
+	return data;
+}
+} // namespace
+
+TEST_CASE("Integer format converters take the upper 16 bits") {
+	auto data = test_bytes();
+
+	check_converter(FormatConvert::s16, 2, data, [](const uint8_t *p) { return (int16_t)(p[1] << 8 | p[0]); });
+	check_converter(FormatConvert::s24, 3, data, [](const uint8_t *p) { return (int16_t)(p[2] << 8 | p[1]); });
+	check_converter(FormatConvert::s32, 4, data, [](const uint8_t *p) { return (int16_t)(p[3] << 8 | p[2]); });
+	check_converter(FormatConvert::u8, 1, data, [](const uint8_t *p) { return (int16_t)((p[0] - 128) * 256); });
+}
+
+TEST_CASE("Float format converter scales, truncates and saturates") {
+	std::vector<float> floats(104);
+	for (uint32_t i = 0; i < floats.size(); i++)
+		floats[i] = (float)i / 40.f - 1.3f;
+	floats[10] = 1.f;
+	floats[11] = -1.f;
+	floats[12] = -0.99999f;
+	floats[13] = 1e30f;
+	floats[14] = -1e30f;
+
+	std::vector<uint8_t> data(floats.size() * 4 + 4);
+	std::memcpy(data.data(), floats.data(), floats.size() * 4);
+
+	// Same as the original scalar loader code
+	check_converter(FormatConvert::f32, 4, data, [](const uint8_t *p) -> int16_t {
+		float f;
+		std::memcpy(&f, p, 4);
+		if (f >= 1.f)
+			return 32767;
+		else if (f <= -1.f)
+			return -32768;
+		else
+			return (int16_t)(f * 32767.f);
+	});
+
+	int16_t out[5];
+	FormatConvert::f32(&data[40], out, 5);
+	CHECK(out[0] == 32767);
+	CHECK(out[1] == -32768);
+	CHECK(out[2] == -32766);
+	CHECK(out[3] == 32767);
+	CHECK(out[4] == -32768);
+}
+
+TEST_CASE("Converters are chosen by sample size and format tag") {
+	CHECK((FormatConvert::for_format(1, 1) == FormatConvert::u8));
+	CHECK((FormatConvert::for_format(2, 1) == FormatConvert::s16));
+	CHECK((FormatConvert::for_format(3, 1) == FormatConvert::s24));
+	CHECK((FormatConvert::for_format(4, 1) == FormatConvert::s32));
+	CHECK((FormatConvert::for_format(4, 3) == FormatConvert::f32));
+	CHECK((FormatConvert::for_format(4, 2) == nullptr));
+	CHECK((FormatConvert::for_format(5, 1) == nullptr));
+}
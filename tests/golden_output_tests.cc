@@ -0,0 +1,412 @@
+#include "doctest.h"
+//
+#include "host_memory.hh"
+#include "mix_kernels.hh"
+#include "resample.hh"
+#include "resample_sinc.hh"
+#include "src/sample_header.hh"
+#include "timing_calcs.hh"
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Golden-output tests for the playback chain: resampler -> envelope -> output mapping.
+//
+// Each case renders a note (fade up, play, fade down) and compares the interleaved output with
+// tests/golden/<case>-<quality>.bin (raw little-endian int32 frames). Every kernel that implements a
+// quality mode must stay within that mode's tolerance of the golden output.
+//
+// The output is also compared with the same chain computed in double precision (exact Hermite, or
+// an exact windowed-sinc with no coefficient table), and the SNR is reported.
+//
+// After an intended change to the output, regenerate the golden files with:
+// UPDATE_GOLDEN=1 tests/build/runtests
+
+using namespace SamplerKit;
+
+namespace
+{
+constexpr uint32_t BlockSize = 16;
+constexpr uint32_t NumBlocks = 48;
+constexpr uint32_t NumFrames = BlockSize * NumBlocks;
+
+// 4ms fades at 48k, so the note fits in NumBlocks
+constexpr uint32_t FadeBlocks = 12;
+const float FadeRate = TimingCalcs::calc_fade_updown_rate(48000.f, BlockSize, 4);
+constexpr float Gain = 0.8f;
+
+// The start of the output depends on how each kernel makes up the history before the first frame
+constexpr uint32_t SnrSkipFrames = BlockSize * 4;
+
+enum class Quality { Standard, High16, High32 };
+
+enum class Kernel { Phase, PhaseX4, PhaseInt, Rational, RationalX4, Sinc16, Sinc32 };
+
+struct Source {
+	std::vector<int16_t> data;
+	unsigned chans;
+};
+
+Source load_test_wav() {
+	Source src{{}, 0};
+	FILE *file = fopen("tests/test.wav", "r");
+	if (!file)
+		return src;
+	Sample s;
+	if (load_sample_header(&s, file) == 0) {
+		src.chans = s.numChannels;
+		src.data.resize(s.sampleSize / 2);
+		fseek(file, s.startOfData, SEEK_SET);
+		src.data.resize(fread(src.data.data(), 2, src.data.size(), file));
+	}
+	fclose(file);
+	return src;
+}
+
+// Mono linear chirp from DC to 0.45 cycles/sample
+Source make_chirp(uint32_t frames) {
+	Source src{std::vector<int16_t>(frames), 1};
+	for (uint32_t i = 0; i < frames; i++) {
+		double phase = M_PI * 0.45 * (double)i * i / frames;
+		src.data[i] = (int16_t)std::lround(24000. * std::sin(phase));
+	}
+	return src;
+}
+
+struct Case {
+	const char *name;
+	const Source &src;
+	bool stereo_mode;
+	float rs;
+	uint32_t sample_rate; // non-zero if played untransposed, so the rational kernel applies
+};
+
+// Channel layout used by SamplerAudio::play_audio_from_buffer() for this case
+WavChan case_chan(const Case &c) {
+	if (c.src.chans == 1)
+		return WavChan::Mono;
+	return c.stereo_mode ? WavChan::Stereo : WavChan::Average;
+}
+
+// Sample value (24-bit scale) as read by get_sample<Chan> or get_stereo_frame
+double source_frame(const Case &c, WavChan chan, int64_t i, bool right) {
+	i = std::max<int64_t>(i, 0);
+	auto &d = c.src.data;
+	if (chan == WavChan::Mono)
+		return d[i] * 256.;
+	if (chan == WavChan::Average)
+		return (d[i * 2] + d[i * 2 + 1]) * 128.;
+	return d[i * 2 + (right ? 1 : 0)] * 256.;
+}
+
+// Drives the envelope blocks that SamplerAudio::apply_envelopes() runs for a note with fadeupdown_env:
+// PLAY_FADEUP until the envelope reaches 1, then PLAYING, then PLAY_FADEDOWN (from StartFadeDown) for the last
+// FadeBlocks
+struct Envelope {
+	float level = 0.f;
+	bool fading_up = true;
+	bool fading_down = false;
+
+	void apply(unsigned blk, std::span<int32_t> L, std::span<int32_t> R) {
+		if (blk == NumBlocks - FadeBlocks) {
+			fading_down = true;
+			level = 1.f;
+		}
+		if (fading_down)
+			fade_down_block(L, R, Gain, level, FadeRate, true);
+		else if (fading_up)
+			fading_up = !fade_up_block(L, R, Gain, level, FadeRate, true);
+		else
+			apply_gain(L, R, Gain);
+	}
+};
+
+// Renders a case through one kernel, and returns the interleaved output frames
+template<WavChan Chan>
+std::vector<int32_t> render(HostMemory &mem, const Case &c, Kernel kernel) {
+	CircularBuffer buf;
+	mem.attach(buf);
+	ResamplerState left, right;
+	SincState<16> sinc16;
+	SincState<32> sinc32;
+	RationalHermiteTable table;
+	if (kernel == Kernel::Rational || kernel == Kernel::RationalX4)
+		table.build(RateRatio::make(c.sample_rate, 48000));
+	const uint64_t step = phase_step(c.rs);
+
+	std::array<int32_t, BlockSize> L{}, R{};
+	Envelope env;
+	std::vector<int32_t> out(NumFrames * 2);
+
+	for (unsigned blk = 0; blk < NumBlocks; blk++) {
+		bool flush = blk == 0;
+		switch (kernel) {
+			case Kernel::Phase:
+				resample_read_phase<Chan>(step, &buf, L, R, false, flush, left, right);
+				break;
+			case Kernel::PhaseX4:
+				resample_read_phase_x4<Chan>(step, &buf, L, R, false, flush, left, right);
+				break;
+			case Kernel::PhaseInt:
+				resample_read_phase_int<Chan>(step, &buf, L, R, false, flush, left, right);
+				break;
+			case Kernel::Rational:
+				resample_read_rational_int<Chan>(table, &buf, L, R, false, flush, left, right);
+				break;
+			case Kernel::RationalX4:
+				resample_read_rational_x4<Chan>(table, &buf, L, R, false, flush, left, right);
+				break;
+			case Kernel::Sinc16:
+				resample_read_sinc<Chan>(step, &buf, L, R, false, flush, sinc16);
+				break;
+			case Kernel::Sinc32:
+				resample_read_sinc<Chan>(step, &buf, L, R, false, flush, sinc32);
+				break;
+		}
+		if (c.src.chans == 1 && c.stereo_mode)
+			R = L;
+
+		env.apply(blk, L, R);
+
+		auto frames = std::span{out}.subspan(blk * BlockSize * 2, BlockSize * 2);
+		if (c.stereo_mode)
+			write_stereo_out(frames, L, R);
+		else
+			write_mono_out(frames, L);
+	}
+	return out;
+}
+
+std::vector<int32_t> render(HostMemory &mem, const Case &c, Kernel kernel) {
+	switch (case_chan(c)) {
+		case WavChan::Stereo:
+			return render<WavChan::Stereo>(mem, c, kernel);
+		case WavChan::Average:
+			return render<WavChan::Average>(mem, c, kernel);
+		default:
+			return render<WavChan::Mono>(mem, c, kernel);
+	}
+}
+
+// Windowed-sinc coefficient for a tap at distance x from the output position, as in SincTable
+template<unsigned Taps>
+double sinc_coef(double x) {
+	using Table = SincTable<Taps, 64>;
+	constexpr double half = Taps / 2;
+	double w = x / half;
+	if (w * w >= 1)
+		return 0;
+	return ConstexprMath::sinc(Table::Cutoff * x) * std::cyl_bessel_i(0., Table::Beta * std::sqrt(1 - w * w)) /
+		   std::cyl_bessel_i(0., Table::Beta);
+}
+
+template<unsigned Taps>
+double sinc_interp(const Case &c, WavChan chan, bool right, int64_t i, double t) {
+	double acc = 0, sum = 0;
+	for (unsigned k = 0; k < Taps; k++) {
+		double h = sinc_coef<Taps>((double)k - (Taps / 2 - 1) - t);
+		acc += h * source_frame(c, chan, i - (Taps / 2 - 1) + k, right);
+		sum += h;
+	}
+	return acc / sum;
+}
+
+double hermite_interp(const Case &c, WavChan chan, bool right, int64_t i, double t) {
+	double xm1 = source_frame(c, chan, i - 1, right);
+	double x0 = source_frame(c, chan, i, right);
+	double x1 = source_frame(c, chan, i + 1, right);
+	double x2 = source_frame(c, chan, i + 2, right);
+	double a = (3 * (x0 - x1) - xm1 + x2) / 2;
+	double b = 2 * x1 + xm1 - (5 * x0 + x2) / 2;
+	double cc = (x1 - xm1) / 2;
+	return ((a * t + b) * t + cc) * t + x0;
+}
+
+// The whole chain in double precision, at the exact read positions
+std::vector<double> render_reference(const Case &c, Quality quality) {
+	const WavChan chan = case_chan(c);
+	const double rs = c.sample_rate ? c.sample_rate / 48000. : c.rs;
+
+	auto interp = [&](bool right, uint32_t n) {
+		// The first output is at the frame after the start of the buffer
+		double pos = 1 + n * rs;
+		auto i = (int64_t)std::floor(pos);
+		double t = pos - i;
+		double v = quality == Quality::Standard ? hermite_interp(c, chan, right, i, t) :
+				   quality == Quality::High16	? sinc_interp<16>(c, chan, right, i, t) :
+												  sinc_interp<32>(c, chan, right, i, t);
+		return std::clamp(v, -32768. * 256., 32767. * 256.);
+	};
+
+	std::vector<double> out(NumFrames * 2);
+	double level = 0;
+	bool fading_up = true;
+	for (uint32_t n = 0; n < NumFrames; n++) {
+		unsigned blk = n / BlockSize;
+		double amp;
+		if (blk >= NumBlocks - FadeBlocks)
+			amp = level = std::max(level - FadeRate, 0.);
+		else if (fading_up)
+			amp = level = std::min(level + FadeRate, 1.);
+		else
+			amp = 1;
+		if (n % BlockSize == BlockSize - 1 && level >= 1)
+			fading_up = false;
+
+		double l = interp(false, n) * amp * Gain;
+		if (c.stereo_mode) {
+			double r = c.src.chans == 2 ? interp(true, n) * amp * Gain : l;
+			out[n * 2] = -r;
+			out[n * 2 + 1] = -l;
+		} else {
+			out[n * 2] = l;
+			out[n * 2 + 1] = -l;
+		}
+	}
+	return out;
+}
+
+double snr_db(const std::vector<int32_t> &out, const std::vector<double> &ref) {
+	double signal = 0, noise = 0;
+	for (uint32_t i = SnrSkipFrames * 2; i < out.size(); i++) {
+		signal += ref[i] * ref[i];
+		noise += (out[i] - ref[i]) * (out[i] - ref[i]);
+	}
+	return noise > 0 ? 10 * std::log10(signal / noise) : 200.;
+}
+
+std::string quality_name(Quality q) {
+	return q == Quality::Standard ? "standard" : q == Quality::High16 ? "high16" : "high32";
+}
+
+std::string kernel_name(Kernel k) {
+	switch (k) {
+		case Kernel::Phase:
+			return "phase";
+		case Kernel::PhaseX4:
+			return "phase_x4";
+		case Kernel::PhaseInt:
+			return "phase_int";
+		case Kernel::Rational:
+			return "rational";
+		case Kernel::RationalX4:
+			return "rational_x4";
+		case Kernel::Sinc16:
+			return "sinc16";
+		case Kernel::Sinc32:
+			return "sinc32";
+	}
+	return "";
+}
+
+// Largest allowed difference from the golden output (24-bit units).
+// The Standard golden output comes from the float phase kernel, and the integer kernels
+// round their coefficients to Q14, so they are allowed one 16-bit LSB.
+// High quality kernels only differ by float rounding (e.g. FMA contraction on other compilers)
+int32_t tolerance(Quality q) {
+	return q == Quality::Standard ? 256 : 16;
+}
+
+// Measured: at least 98dB for the integer Hermite kernels, 120dB for the float ones, 104dB for sinc
+// (whose error is mostly from interpolating between the 64 table rows)
+double min_snr_db(Quality q) {
+	return q == Quality::Standard ? 90. : 95.;
+}
+
+bool update_golden() {
+	auto env = getenv("UPDATE_GOLDEN");
+	return env && env[0] && env[0] != '0';
+}
+
+std::string golden_path(const Case &c, Quality q) {
+	return "tests/golden/" + std::string{c.name} + "-" + quality_name(q) + ".bin";
+}
+
+bool read_golden(const std::string &path, std::vector<int32_t> &golden) {
+	FILE *file = fopen(path.c_str(), "rb");
+	if (!file)
+		return false;
+	golden.resize(NumFrames * 2);
+	auto n = fread(golden.data(), sizeof(int32_t), golden.size(), file);
+	fclose(file);
+	return n == golden.size();
+}
+
+void write_golden(const std::string &path, const std::vector<int32_t> &out) {
+	FILE *file = fopen(path.c_str(), "wb");
+	REQUIRE(file != nullptr);
+	fwrite(out.data(), sizeof(int32_t), out.size(), file);
+	fclose(file);
+}
+
+} // namespace
+
+TEST_CASE("Playback chain output matches the golden files, and the double-precision reference") {
+	const Source wav = load_test_wav();
+	REQUIRE(wav.chans == 2);
+	const Source chirp = make_chirp(8192);
+
+	HostMemory mem{0x40000};
+	REQUIRE(mem.base);
+
+	const Case cases[] = {
+		{"wav-stereo-0.50", wav, true, 0.5f, 0},
+		{"wav-stereo-1.37", wav, true, 1.37f, 0},
+		{"wav-stereo-44k", wav, true, 44100.f / 48000.f, 44100},
+		{"wav-mono-3.00", wav, false, 3.f, 0},
+		{"chirp-stereo-0.75", chirp, true, 0.75f, 0},
+		{"chirp-mono-2.00", chirp, false, 2.f, 0},
+	};
+
+	for (auto &c : cases) {
+		const std::string case_name = c.name;
+		CAPTURE(case_name);
+		REQUIRE(c.src.data.size() * 2 <= mem.size);
+		std::copy(c.src.data.begin(), c.src.data.end(), reinterpret_cast<int16_t *>(mem.base));
+
+		for (auto quality : {Quality::Standard, Quality::High16, Quality::High32}) {
+			const auto quality_str = quality_name(quality);
+			CAPTURE(quality_str);
+
+			// The first kernel of each mode generates the golden output
+			std::vector<Kernel> kernels;
+			if (quality == Quality::Standard) {
+				kernels = {Kernel::Phase, Kernel::PhaseX4, Kernel::PhaseInt};
+				if (c.sample_rate) {
+					kernels.push_back(Kernel::Rational);
+					kernels.push_back(Kernel::RationalX4);
+				}
+			} else
+				kernels = {quality == Quality::High16 ? Kernel::Sinc16 : Kernel::Sinc32};
+
+			const auto path = golden_path(c, quality);
+			std::vector<int32_t> golden;
+			if (update_golden())
+				write_golden(path, render(mem, c, kernels[0]));
+			if (!read_golden(path, golden)) {
+				FAIL("Missing golden file ", path, ", run with UPDATE_GOLDEN=1 to create it");
+				continue;
+			}
+
+			const auto reference = render_reference(c, quality);
+
+			for (auto kernel : kernels) {
+				const auto kernel_str = kernel_name(kernel);
+				CAPTURE(kernel_str);
+				const auto out = render(mem, c, kernel);
+
+				int32_t max_diff = 0;
+				for (uint32_t i = 0; i < out.size(); i++)
+					max_diff = std::max(max_diff, std::abs(out[i] - golden[i]));
+				CHECK(max_diff <= tolerance(quality));
+
+				double snr = snr_db(out, reference);
+				MESSAGE(case_name, " ", quality_str, " ", kernel_str, ": SNR ", snr, " dB");
+				CHECK(snr > min_snr_db(quality));
+			}
+		}
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "circular_buffer.hh"
+#include <cstdint>
+#include <cstring>
+#include <sys/mman.h>
+
+// Stands in for SDRAM in host tests.
+// The firmware stores buffer positions as 32-bit addresses, so the memory must be mapped below 4GB.
+struct HostMemory {
+	uint8_t *base = nullptr;
+	uint32_t size;
+
+	HostMemory(uint32_t size)
+		: size{size} {
+#ifdef MAP_32BIT
+		void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+#else
+		void *p = mmap((void *)0x40000000, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#endif
+		if (p != MAP_FAILED && (reinterpret_cast<uintptr_t>(p) + size) <= 0xFFFFFFFFu)
+			base = static_cast<uint8_t *>(p);
+	}
+
+	~HostMemory() {
+		if (base)
+			munmap(base, size);
+	}
+
+	uint32_t addr() const { return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(base)); }
+
+	void attach(SamplerKit::CircularBuffer &buf) const {
+		buf.min = addr();
+		buf.max = addr() + size;
+		buf.size = size;
+		buf.init();
+	}
+};
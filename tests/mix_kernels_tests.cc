@@ -0,0 +1,114 @@
+#include "doctest.h"
+//
+#include "mix_kernels.hh"
+#include <array>
+
+using namespace SamplerKit;
+
+namespace
+{
+constexpr uint32_t BlockSize = 16;
+constexpr int32_t Max24 = (1 << 23) - 1;
+constexpr int32_t Min24 = -(1 << 23);
+} // namespace
+
+TEST_CASE("fade ramps the amplitude once per frame, and stops at 0 and 1") {
+	std::array<int32_t, BlockSize> L, R;
+	L.fill(100000);
+	R.fill(-100000);
+
+	float amp = fade(L, R, 1.f, 0.f, 0.125f);
+	CHECK(amp == 1.f);
+	CHECK(L[0] == 12500);
+	CHECK(R[0] == -12500);
+	CHECK(L[3] == 50000);
+	CHECK(L[6] == 87500);
+	CHECK(L[7] == 100000);
+	CHECK(L[15] == 100000);
+	CHECK(R[15] == -100000);
+
+	L.fill(100000);
+	R.fill(100000);
+	amp = fade(L, R, 0.5f, 0.5f, -0.0625f);
+	CHECK(amp == 0.f);
+	CHECK(L[0] == 21875);
+	CHECK(L[7] == 0);
+	CHECK(R[15] == 0);
+}
+
+TEST_CASE("fade and apply_gain saturate to 24 bits") {
+	std::array<int32_t, BlockSize> L, R;
+	L.fill(Max24);
+	R.fill(Min24);
+	apply_gain(L, R, 4.f);
+	for (unsigned i = 0; i < BlockSize; i++) {
+		CHECK(L[i] == Max24);
+		CHECK(R[i] == Min24);
+	}
+
+	L.fill(Max24);
+	R.fill(Min24);
+	fade(L, R, 4.f, 1.f, 0.f);
+	for (unsigned i = 0; i < BlockSize; i++) {
+		CHECK(L[i] == Max24);
+		CHECK(R[i] == Min24);
+	}
+
+	L.fill(1000);
+	R.fill(-1000);
+	apply_gain(L, R, 0.5f);
+	CHECK(L[5] == 500);
+	CHECK(R[5] == -500);
+}
+
+TEST_CASE("Fade up and down blocks report the end of the fade, or end at once without the envelope") {
+	std::array<int32_t, BlockSize> L, R;
+	L.fill(1000);
+	R.fill(1000);
+	float level = 0.f;
+	CHECK_FALSE(fade_up_block(L, R, 1.f, level, 0.03125f, true));
+	CHECK(level == 0.5f);
+	CHECK(fade_up_block(L, R, 1.f, level, 0.03125f, true));
+	CHECK(level == 1.f);
+
+	L.fill(1000);
+	R.fill(1000);
+	CHECK_FALSE(fade_down_block(L, R, 1.f, level, 0.03125f, true));
+	CHECK(L[15] == 500);
+	CHECK(fade_down_block(L, R, 1.f, level, 0.03125f, true));
+	CHECK(level == 0.f);
+
+	// Without the envelope, each block is at full gain and the level is untouched by fade up
+	L.fill(1000);
+	R.fill(1000);
+	level = 0.25f;
+	CHECK(fade_up_block(L, R, 0.5f, level, 0.03125f, false));
+	CHECK(level == 0.25f);
+	CHECK(L[0] == 500);
+	CHECK(fade_down_block(L, R, 2.f, level, 0.03125f, false));
+	CHECK(level == 0.f);
+	CHECK(R[15] == 1000);
+}
+
+TEST_CASE("output writers invert and interleave") {
+	std::array<int32_t, BlockSize> L, R;
+	std::array<int32_t, BlockSize * 2> out;
+	for (unsigned i = 0; i < BlockSize; i++) {
+		L[i] = i * 1000;
+		R[i] = -(int32_t)i * 10;
+	}
+	L[9] = Min24;
+
+	write_stereo_out(out, L, R);
+	for (unsigned i = 0; i < BlockSize; i++) {
+		CHECK(out[i * 2 + 1] == ssat24(-L[i]));
+		CHECK(out[i * 2] == -R[i]);
+	}
+	CHECK(out[9 * 2 + 1] == Max24);
+
+	write_mono_out(out, L);
+	for (unsigned i = 0; i < BlockSize; i++) {
+		CHECK(out[i * 2] == L[i]);
+		CHECK(out[i * 2 + 1] == ssat24(-L[i]));
+	}
+}
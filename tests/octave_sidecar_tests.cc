@@ -0,0 +1,154 @@
+#include "doctest.h"
+//
+#include "format_convert.hh"
+#include "octave_sidecar.hh"
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace SamplerKit;
+using namespace SamplerKit::OctaveSidecar;
+
+namespace
+{
+// freq is in cycles per sample
+std::vector<int16_t> sine(uint32_t frames, unsigned chans, float freq, float amp = 16000.f) {
+	std::vector<int16_t> v(frames * chans);
+	for (uint32_t i = 0; i < frames; i++)
+		for (unsigned c = 0; c < chans; c++)
+			v[i * chans + c] = amp * std::sin(2.f * (float)M_PI * freq * i + c);
+	return v;
+}
+
+std::vector<int16_t> decimate(const std::vector<int16_t> &in, unsigned chans) {
+	HalfbandDecimator dec;
+	dec.reset(chans);
+	std::vector<int16_t> out(in.size() / 2 + 64);
+	uint32_t frames = dec.process(in.data(), in.size() / chans, out.data());
+	frames += dec.flush(&out[frames * chans]);
+	out.resize(frames * chans);
+	return out;
+}
+
+float peak(const std::vector<int16_t> &v, uint32_t skip) {
+	float p = 0;
+	for (uint32_t i = skip; i < v.size() - skip; i++)
+		p = std::max(p, std::fabs((float)v[i]));
+	return p;
+}
+
+Sample make_sample(uint32_t frames, uint8_t bytes, uint8_t chans, uint32_t rate) {
+	Sample s{};
+	s.sampleByteSize = bytes;
+	s.numChannels = chans;
+	s.blockAlign = bytes * chans;
+	s.sampleRate = rate;
+	s.sampleSize = frames * s.blockAlign;
+	s.startOfData = 100;
+	s.PCM = 1;
+	s.inst_start = 0;
+	s.inst_end = s.sampleSize;
+	s.inst_size = s.sampleSize;
+	return s;
+}
+} // namespace
+
+TEST_CASE("Halfband decimator output length is ceil(n/2), aligned with the input") {
+	for (uint32_t n : {1u, 2u, 15u, 16u, 31u, 100u, 1001u}) {
+		std::vector<int16_t> in(n, 0);
+		CHECK(decimate(in, 1).size() == (n + 1) / 2);
+	}
+
+	// A DC level passes with unity gain, and output m lines up with input 2m
+	std::vector<int16_t> ramp(400);
+	for (unsigned i = 0; i < ramp.size(); i++)
+		ramp[i] = i * 20;
+	auto out = decimate(ramp, 1);
+	for (unsigned m = 20; m < 180; m++)
+		CHECK(std::abs(out[m] - ramp[m * 2]) <= 1);
+}
+
+TEST_CASE("Halfband decimator passes low frequencies and removes ones above the new Nyquist") {
+	for (unsigned chans : {1u, 2u}) {
+		auto low = decimate(sine(4000, chans, 0.0125f), chans);
+		CHECK(peak(low, 64) == doctest::Approx(16000).epsilon(0.01));
+
+		// 0.4 cycles/sample would alias to 0.2 after decimation
+		auto high = decimate(sine(4000, chans, 0.4f), chans);
+		CHECK(peak(high, 64) < 16000 * 0.003f);
+	}
+}
+
+TEST_CASE("Decimating in chunks and in place matches decimating all at once") {
+	auto in = sine(1000, 2, 0.03f);
+	auto whole = decimate(in, 2);
+
+	HalfbandDecimator dec;
+	dec.reset(2);
+	std::vector<int16_t> buf = in;
+	std::vector<int16_t> chunked;
+	for (uint32_t pos = 0; pos < 1000; pos += 99) {
+		uint32_t frames = std::min(99u, 1000 - pos);
+		int16_t *p = &buf[pos * 2];
+		uint32_t n = dec.process(p, frames, p);
+		chunked.insert(chunked.end(), p, p + n * 2);
+	}
+	int16_t tail[64];
+	uint32_t n = dec.flush(tail);
+	chunked.insert(chunked.end(), tail, tail + n * 2);
+
+	CHECK(chunked == whole);
+}
+
+TEST_CASE("Sidecar Sample is 16-bit and its positions scale with the level") {
+	Sample src = make_sample(100001, 3, 2, 48000);
+	src.inst_start = 1000 * 6;
+	src.inst_end = 90001 * 6;
+	src.inst_size = src.inst_end - src.inst_start;
+	src.num_cues = 2;
+	src.cue[0] = 800;
+	src.cue[1] = 50000;
+
+	Sample s = sidecar_sample(src, 2, "_STS.system/oct-0-2.wav");
+	CHECK(s.sampleRate == 12000);
+	CHECK(s.sampleByteSize == 2);
+	CHECK(s.blockAlign == 4);
+	CHECK(s.startOfData == 44);
+	CHECK(s.sampleSize == 25001 * 4);
+	CHECK(s.inst_start == 250 * 4);
+	CHECK(s.inst_end == 22500 * 4);
+	CHECK(s.inst_size == s.inst_end - s.inst_start);
+	CHECK(s.cue[0] == 200);
+	CHECK(s.cue[1] == 12500);
+	CHECK(std::string{s.filename} == "_STS.system/oct-0-2.wav");
+}
+
+TEST_CASE("Levels are chosen by resample rate and readiness") {
+	CHECK(choose_level(1.f, 0b1111) == 0);
+	CHECK(choose_level(1.99f, 0b1111) == 0);
+	CHECK(choose_level(2.f, 0b1111) == 1);
+	CHECK(choose_level(5.f, 0b1111) == 2);
+	CHECK(choose_level(16.f, 0b1111) == 3);
+	CHECK(choose_level(16.f, 0b0011) == 1);
+	CHECK(choose_level(16.f, 0b1101) == 0);
+	CHECK(choose_level(16.f, 0b0001) == 0);
+}
+
+TEST_CASE("Only long samples with evenly divisible rates get sidecars") {
+	CHECK(max_level(make_sample(1000000, 2, 2, 48000)) == 3);
+	CHECK(max_level(make_sample(1000000, 2, 2, 44100)) == 2);
+	CHECK(max_level(make_sample(1000000, 2, 2, 22050)) == 1);
+	CHECK(max_level(make_sample(1000, 2, 2, 48000)) == 0);
+	CHECK(source_id(make_sample(1000, 2, 2, 48000)) != source_id(make_sample(1001, 2, 2, 48000)));
+}
+
+TEST_CASE("Every format that gets sidecars has a 16-bit converter") {
+	for (auto [bytes, PCM] : {std::pair{1, 1}, {2, 1}, {3, 1}, {4, 1}, {4, 3}}) {
+		CAPTURE(bytes);
+		Sample s = make_sample(1000000, bytes, 2, 48000);
+		s.PCM = PCM;
+		CHECK(max_level(s) > 0);
+		bool has_converter = FormatConvert::for_format(s.sampleByteSize, s.PCM) != nullptr;
+		CHECK(has_converter);
+	}
+}
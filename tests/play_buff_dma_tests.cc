@@ -0,0 +1,120 @@
+#include "doctest.h"
+//
+#include "host_memory.hh"
+#include "play_buff_dma.hh"
+#include <cstring>
+#include <vector>
+
+using namespace SamplerKit;
+
+namespace
+{
+// Stands in for a DMA stream: a transfer completes after a few calls to busy()
+struct FakeDma {
+	static inline std::vector<uint32_t> transfer_bytes;
+	static inline const void *src;
+	static inline void *dst;
+	static inline uint32_t bytes;
+	static inline unsigned polls_left = 0;
+
+	static void start(const void *s, void *d, uint32_t b) {
+		REQUIRE(polls_left == 0);
+		src = s;
+		dst = d;
+		bytes = b;
+		polls_left = 3;
+		transfer_bytes.push_back(b);
+	}
+
+	static bool busy() {
+		if (polls_left && --polls_left == 0)
+			std::memcpy(dst, src, bytes);
+		return polls_left;
+	}
+};
+} // namespace
+
+TEST_CASE("PlayBuffDma splits the copy at the wrap, and finishes both parts") {
+	constexpr uint32_t MemSize = 0x400;
+	HostMemory mem{MemSize};
+	REQUIRE(mem.base);
+
+	std::vector<int16_t> data(300);
+	for (uint32_t i = 0; i < data.size(); i++)
+		data[i] = (int16_t)(i * 97 - 5000);
+
+	for (uint32_t start : {0x100u, MemSize - 0x40}) {
+		CAPTURE(start);
+		std::memset(mem.base, 0, MemSize);
+		CircularBuffer buf;
+		mem.attach(buf);
+		buf.in = buf.min + start;
+		FakeDma::transfer_bytes.clear();
+
+		PlayBuffDma<FakeDma> dma;
+		dma.start(buf, data.data(), data.size());
+		CHECK(buf.in == buf.min + (start + 600) % MemSize);
+
+		unsigned polls = 0;
+		while (!dma.poll())
+			polls++;
+		CHECK(polls > 0);
+
+		if (start + 600 > MemSize)
+			CHECK(FakeDma::transfer_bytes == std::vector<uint32_t>{MemSize - start, 600 - (MemSize - start)});
+		else
+			CHECK(FakeDma::transfer_bytes == std::vector<uint32_t>{600});
+
+		for (uint32_t i = 0; i < data.size(); i++) {
+			int16_t v;
+			std::memcpy(&v, &mem.base[(start + i * 2) % MemSize], 2);
+			CHECK(v == data[i]);
+		}
+
+		// Nothing left to do
+		CHECK(dma.poll());
+	}
+}
+
+TEST_CASE("A copy is published only once it has landed, before an in-place read after it") {
+	constexpr uint32_t MemSize = 0x400;
+	HostMemory mem{MemSize};
+	REQUIRE(mem.base);
+	std::memset(mem.base, 0, MemSize);
+	CircularBuffer buf;
+	mem.attach(buf);
+
+	// A read through the bounce buffer at the wrap
+	std::vector<int16_t> bounced(64, 0x1234);
+	buf.in = buf.max - 0x40;
+	PlayBuffDma<FakeDma> dma;
+	dma.start(buf, bounced.data(), bounced.size());
+	CHECK(dma.pending());
+	CHECK(dma.copying_from(bounced.data()));
+
+	// Still running: nothing is published to the audio ISR
+	CHECK(dma.finish(false) == nullptr);
+	CHECK(buf.fill() == 0);
+
+	// The in-place read that follows (SampleLoader::read_in_place()) finishes the copy first
+	CHECK(dma.finish(true) == &buf);
+	CHECK_FALSE(dma.pending());
+	CHECK(buf.fill() == 128);
+	for (uint32_t i = 0; i < 128; i++) {
+		uint8_t expected = (i % 2) ? 0x12 : 0x34;
+		CHECK(mem.base[(MemSize - 0x40 + i) % MemSize] == expected);
+	}
+
+	// Then the file is read straight to the in ptr, which is moved and published past it
+	const uint32_t in_place = buf.in;
+	std::memset(reinterpret_cast<void *>(in_place), 0x56, 0x100);
+	buf.offset_in_address(0x100, false);
+	buf.written(0x100);
+	CHECK(buf.fill() == 0x180);
+	CHECK(mem.base[in_place - buf.min + 0xFF] == 0x56);
+	CHECK(mem.base[0x3F] == 0x12);
+
+	// Nothing left to publish
+	CHECK(dma.finish(true) == nullptr);
+	CHECK(buf.fill() == 0x180);
+}
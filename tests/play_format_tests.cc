@@ -0,0 +1,244 @@
+#include "doctest.h"
+//
+#include "cache.hh"
+#include "format_convert.hh"
+#include "host_memory.hh"
+#include "resample.hh"
+#include "resample_sinc.hh"
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace SamplerKit;
+
+namespace
+{
+constexpr uint32_t BlockSize = 16;
+constexpr uint32_t NumSamples = 0x2000;
+constexpr unsigned SincTaps = 16;
+
+// Stereo sine with 8 significant bits, written to mem in format F with the extra bits zero,
+// so all three formats hold the same audio
+template<PlayFormat F>
+void fill_sine(HostMemory &mem) {
+	for (uint32_t i = 0; i < NumSamples; i++) {
+		float x = (i & 1) ? 0.5f * std::sin(i * 0.0071f + 1.f) : 0.9f * std::sin(i * 0.031f);
+		int8_t s8 = (int8_t)(x * 127.f);
+		int32_t s24 = s8 * 65536;
+		if constexpr (F == PlayFormat::S8)
+			mem.base[i] = (uint8_t)s8;
+		else if constexpr (F == PlayFormat::S24)
+			std::memcpy(&mem.base[i * 3], &s24, 3);
+		else {
+			int16_t s16 = s8 * 256;
+			std::memcpy(&mem.base[i * 2], &s16, 2);
+		}
+	}
+}
+
+// Runs a kernel on 16-bit storage and on format F storage of the same audio, and checks the outputs and
+// read positions are identical
+template<PlayFormat F, typename Kernel>
+void check_matches_s16(Kernel &&kernel) {
+	HostMemory ref_mem{NumSamples * 2}, mem{NumSamples * play_bytes(F)};
+	REQUIRE(ref_mem.base);
+	REQUIRE(mem.base);
+	fill_sine<PlayFormat::S16>(ref_mem);
+	fill_sine<F>(mem);
+
+	for (bool rev : {false, true}) {
+		for (float rs : {0.37f, 1.f, 1.5f, 4.7f}) {
+			CAPTURE(rev);
+			CAPTURE(rs);
+			CircularBuffer ref, buf;
+			ref_mem.attach(ref);
+			mem.attach(buf);
+			ResamplerState refL, refR, L, R;
+			SincState<SincTaps> ref_sinc, sinc;
+			std::array<int32_t, BlockSize> refoutL{}, refoutR{}, outL{}, outR{};
+
+			for (unsigned blk = 0; blk < 40; blk++) {
+				bool flush = blk == 0;
+				kernel.template operator()<PlayFormat::S16>(
+					phase_step(rs), &ref, refoutL, refoutR, rev, flush, refL, refR, ref_sinc);
+				kernel.template operator()<F>(phase_step(rs), &buf, outL, outR, rev, flush, L, R, sinc);
+				CHECK(outL == refoutL);
+				CHECK(outR == refoutR);
+				CHECK((buf.out - buf.min) * 2 == (ref.out - ref.min) * play_bytes(F));
+			}
+		}
+	}
+}
+
+template<WavChan Chan>
+void check_kernels() {
+	CAPTURE((int)Chan);
+	auto phase = []<PlayFormat G>(uint64_t step, CircularBuffer *b, auto &oL, auto &oR, bool rev, bool flush,
+								  ResamplerState &l, ResamplerState &r, auto &) {
+		resample_read_phase<Chan, G>(step, b, oL, oR, rev, flush, l, r);
+	};
+	auto sinc = []<PlayFormat G>(uint64_t step, CircularBuffer *b, auto &oL, auto &oR, bool rev, bool flush,
+								 ResamplerState &, ResamplerState &, auto &st) {
+		resample_read_sinc<Chan, SincTaps, G>(step, b, oL, oR, rev, flush, st);
+	};
+	auto phase_int = []<PlayFormat G>(uint64_t step, CircularBuffer *b, auto &oL, auto &oR, bool rev, bool flush,
+									  ResamplerState &l, ResamplerState &r, auto &) {
+		resample_read_phase_int<Chan, G>(step, b, oL, oR, rev, flush, l, r);
+	};
+
+	check_matches_s16<PlayFormat::S8>(phase);
+	check_matches_s16<PlayFormat::S24>(phase);
+	check_matches_s16<PlayFormat::S8>(sinc);
+	check_matches_s16<PlayFormat::S24>(sinc);
+	check_matches_s16<PlayFormat::S8>(phase_int);
+}
+} // namespace
+
+TEST_CASE("Kernels play 8-bit and 24-bit storage the same as 16-bit storage of the same audio") {
+	check_kernels<WavChan::Stereo>();
+	check_kernels<WavChan::Mono>();
+	check_kernels<WavChan::Average>();
+	check_kernels<WavChan::Right>();
+}
+
+TEST_CASE("Packed 24-bit storage keeps the low byte") {
+	HostMemory mem{0x1000};
+	REQUIRE(mem.base);
+	for (int32_t v : {0x123456, -0x123456, 0x7FFFFF, -0x800000, -1}) {
+		CAPTURE(v);
+		// At an odd address, like most packed samples
+		std::memcpy(&mem.base[3], &v, 3);
+		uint32_t addr = mem.addr() + 3;
+		CHECK(PlayStorage<PlayFormat::S24>::load(addr) == v);
+		CHECK(PlayStorage<PlayFormat::S24>::load16(addr) == ((uint32_t)v >> 8 & 0xFFFF));
+	}
+}
+
+TEST_CASE("Store converters write the native play buffer formats") {
+	std::vector<uint8_t> u8(37);
+	for (uint32_t i = 0; i < u8.size(); i++)
+		u8[i] = (uint8_t)(i * 29);
+	std::vector<uint8_t> s8(u8.size());
+	FormatConvert::s8_from_u8(u8.data(), s8.data(), u8.size());
+	for (uint32_t i = 0; i < u8.size(); i++)
+		CHECK((int8_t)s8[i] == u8[i] - 128);
+
+	int32_t s32[3] = {0x12345678, -0x12345678, -1};
+	uint8_t s24[9];
+	FormatConvert::s24_from_s32(reinterpret_cast<uint8_t *>(s32), s24, 3);
+	for (uint32_t i = 0; i < 3; i++) {
+		int32_t v = (int32_t)((s24[i * 3] << 8) | (s24[i * 3 + 1] << 16) | (s24[i * 3 + 2] << 24)) >> 8;
+		CHECK(v == s32[i] >> 8);
+	}
+
+	float f32[4] = {0.5f, -1.f, 2.f, -0.25f};
+	FormatConvert::s24_from_f32(reinterpret_cast<uint8_t *>(f32), s24, 3);
+	const int32_t expected[3] = {(int32_t)(0.5f * 8388607.f), -8388608, 8388607};
+	for (uint32_t i = 0; i < 3; i++) {
+		int32_t v = (int32_t)((s24[i * 3] << 8) | (s24[i * 3 + 1] << 16) | (s24[i * 3 + 2] << 24)) >> 8;
+		CHECK(v == expected[i]);
+	}
+
+	CHECK((FormatConvert::for_storage(PlayFormat::S8, 1, 1) == FormatConvert::s8_from_u8));
+	CHECK((FormatConvert::for_storage(PlayFormat::S24, 3, 1) == FormatConvert::s24_from_s24));
+	CHECK((FormatConvert::for_storage(PlayFormat::S24, 4, 1) == FormatConvert::s24_from_s32));
+	CHECK((FormatConvert::for_storage(PlayFormat::S24, 4, 3) == FormatConvert::s24_from_f32));
+	CHECK((FormatConvert::for_storage(PlayFormat::S16, 2, 1) == nullptr));
+	CHECK((FormatConvert::for_storage(PlayFormat::S8, 2, 1) == nullptr));
+
+	CHECK(play_format_for(1, false) == PlayFormat::S8);
+	CHECK(play_format_for(2, true) == PlayFormat::S16);
+	CHECK(play_format_for(3, false) == PlayFormat::S16);
+	CHECK(play_format_for(3, true) == PlayFormat::S24);
+	CHECK(play_format_for(4, true) == PlayFormat::S24);
+}
+
+TEST_CASE("memory_write_as writes 3-byte samples across the wrap, in both directions") {
+	constexpr uint32_t MemSize = 0x300;
+	HostMemory mem{MemSize};
+	REQUIRE(mem.base);
+
+	std::vector<uint8_t> data(100 * 3);
+	for (uint32_t i = 0; i < data.size(); i++)
+		data[i] = (uint8_t)(i * 7 + 1);
+
+	for (bool decrement : {false, true}) {
+		CAPTURE(decrement);
+		std::memset(mem.base, 0, MemSize);
+		CircularBuffer buf;
+		mem.attach(buf);
+		uint32_t start = decrement ? 0x60 : MemSize - 0x60;
+		buf.in = mem.addr() + start;
+		buf.memory_write_as(data.data(), 100, 3, FormatConvert::s24_from_s24, 3, decrement);
+
+		for (uint32_t i = 0; i < 100; i++) {
+			uint32_t pos = decrement ? (start + MemSize * 2 - i * 3) % MemSize : (start + i * 3) % MemSize;
+			CAPTURE(i);
+			CHECK(std::memcmp(&mem.base[pos], &data[i * 3], 3) == 0);
+		}
+	}
+}
+
+TEST_CASE("Play buffer sizes are whole frames, so 24-bit writes and reads wrap at max") {
+	// mp153 slot size, with and without the cue pins
+	constexpr uint32_t SlotSize = 0x1180000;
+	REQUIRE(SlotSize % 6 != 0);
+	CHECK(whole_frame_bytes(SlotSize, PlayFormat::S24, 2) % 6 == 0);
+	CHECK(whole_frame_bytes(SlotSize, PlayFormat::S24, 1) % 3 == 0);
+	CHECK(whole_frame_bytes(SlotSize - 0x16800, PlayFormat::S24, 2) % 6 == 0);
+	CHECK(whole_frame_bytes(SlotSize, PlayFormat::S16, 2) == SlotSize);
+	CHECK(SlotSize - whole_frame_bytes(SlotSize, PlayFormat::S24, 2) < 6);
+
+	// A 100-byte slot holds 96 bytes of 24-bit stereo. Nothing is written past that
+	constexpr uint32_t MemSize = 100;
+	HostMemory mem{MemSize};
+	REQUIRE(mem.base);
+	std::memset(mem.base, 0xEE, MemSize);
+	CircularBuffer buf;
+	mem.attach(buf);
+	buf.size = whole_frame_bytes(MemSize, PlayFormat::S24, 2);
+	buf.max = buf.min + buf.size;
+	CHECK(buf.size == 96);
+
+	std::vector<uint8_t> data(50 * 3, 0x11);
+	for (bool decrement : {false, true}) {
+		for (unsigned i = 0; i < 5; i++)
+			buf.memory_write_as(data.data(), 50, 3, FormatConvert::s24_from_s24, 3, decrement);
+	}
+	for (uint32_t i = buf.size; i < MemSize; i++)
+		CHECK(mem.base[i] == 0xEE);
+
+	// The play address lands back on the first frame
+	buf.out = buf.min;
+	for (uint32_t i = 0; i < buf.size / 6; i++)
+		inc_play_addr<6>(&buf, false);
+	CHECK(buf.out == buf.min);
+}
+
+TEST_CASE("Cache maps file positions to 1, 2 or 3 bytes per sample in the play buffer") {
+	constexpr uint32_t MemSize = 0x1200;
+	HostMemory mem{MemSize};
+	REQUIRE(mem.base);
+	CircularBuffer buf;
+	mem.attach(buf);
+
+	for (auto [format, file_bytes] : {std::pair{PlayFormat::S8, 1}, {PlayFormat::S16, 3}, {PlayFormat::S24, 3},
+									  {PlayFormat::S16, 2}, {PlayFormat::S24, 4}}) {
+		CAPTURE((int)format);
+		CAPTURE(file_bytes);
+		Cache cache;
+		cache.format = format;
+		cache.low = 0x1000 * file_bytes;
+		cache.map_pt = mem.addr() + 0x300;
+		cache.size = (MemSize / play_bytes(format)) * file_bytes;
+		cache.high = cache.low + cache.size;
+
+		for (uint32_t sample : {0u, 1u, 100u, MemSize / play_bytes(format) - 1}) {
+			uint32_t file_pos = cache.low + sample * file_bytes;
+			uint32_t addr = cache.map_cache_to_buffer(file_pos, file_bytes, &buf);
+			CHECK(addr == mem.addr() + (0x300 + sample * play_bytes(format)) % MemSize);
+			CHECK(cache.map_buffer_to_cache(addr, file_bytes, &buf) == file_pos);
+		}
+	}
+}
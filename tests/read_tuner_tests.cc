@@ -0,0 +1,112 @@
+#include "doctest.h"
+//
+#include "read_tuner.hh"
+
+using namespace SamplerKit;
+
+TEST_CASE("Read size follows the stream's file rate, in whole granules") {
+	ReadTuner tuner;
+	tuner.set_card_speed(256 * 512, 20); // 6553 bytes/ms
+
+	// 48kHz 16-bit stereo: 192 bytes/ms, 3072 bytes per 16ms
+	CHECK(tuner.read_size(192.f) == 3 * ReadTuner::ReadGranule);
+	CHECK(tuner.read_size(192.f) % 512 == 0);
+
+	// Slow streams still read at least MinReadSize
+	CHECK(tuner.read_size(10.f) == ReadTuner::MinReadSize);
+
+	// Fast streams are capped at MaxReadSize
+	CHECK(tuner.read_size(1600.f) == ReadTuner::MaxReadSize);
+}
+
+TEST_CASE("A card less than 4x faster than the stream gets the largest reads") {
+	ReadTuner tuner;
+	tuner.set_card_speed(256 * 512, 200); // 655 bytes/ms
+	CHECK(tuner.read_size(192.f) == ReadTuner::MaxReadSize);
+
+	tuner.set_card_speed(256 * 512, 100); // 1310 bytes/ms
+	CHECK(tuner.read_size(192.f) == 3 * ReadTuner::ReadGranule);
+}
+
+TEST_CASE("Prebuffer amount covers the worst recent read latency") {
+	ReadTuner tuner;
+	CHECK(tuner.prebuffer(192.f, 1234) == 1234);
+
+	tuner.record_read(9216, 2);
+	CHECK(tuner.prebuffer(192.f, 0) == 192 * (2 + ReadTuner::LatencyMarginMs));
+
+	// A stall raises it, and it decays by 1ms per LatencyDecayReads faster reads
+	tuner.record_read(9216, 30);
+	CHECK(tuner.worst_latency() == 30);
+	for (uint32_t i = 0; i < ReadTuner::LatencyDecayReads * 2; i++)
+		tuner.record_read(9216, 2);
+	CHECK(tuner.worst_latency() == 28);
+	CHECK(tuner.prebuffer(192.f, 1234) == 192 * (28 + ReadTuner::LatencyMarginMs));
+}
+
+TEST_CASE("A fast card never prebuffers less than the base amount") {
+	ReadTuner tuner;
+	for (uint32_t i = 0; i < 10; i++)
+		tuner.record_read(9216, 0);
+	CHECK(tuner.worst_latency() == 0);
+	CHECK(tuner.prebuffer(192.f, 1234) == 1234);
+
+	tuner.record_read(9216, 1);
+	CHECK(tuner.prebuffer(192.f, 1234) == 1234);
+	CHECK(tuner.prebuffer(1536.f, 1234) == 1536 * (1 + ReadTuner::LatencyMarginMs));
+}
+
+TEST_CASE("Throughput is averaged over a window of reads") {
+	ReadTuner tuner;
+	tuner.set_card_speed(256 * 512, 64);
+	CHECK(tuner.throughput() == 2048);
+
+	// Not updated until a full window is read
+	tuner.record_read(ReadTuner::WindowBytes / 2, 8);
+	CHECK(tuner.throughput() == 2048);
+	tuner.record_read(ReadTuner::WindowBytes / 2, 8);
+	CHECK(tuner.throughput() == ReadTuner::WindowBytes / 16);
+}
+
+TEST_CASE("A read from an unaligned position is shortened to end on a sector and a sample block") {
+	// 16-bit stereo, data starting at 44 (as recorded)
+	uint32_t rd = ReadTuner::sector_aligned_read(44 + 400, 4608, 44, 4);
+	CHECK(rd == 4608 - 444);
+	CHECK((444 + rd) % 512 == 0);
+
+	// Once aligned, reads of granule multiples are left whole
+	CHECK(ReadTuner::sector_aligned_read(4608, 4608, 44, 4) == 4608);
+	CHECK(ReadTuner::sector_aligned_read(4608 + 4608, 3072, 44, 4) == 3072);
+
+	// 24-bit stereo: the end must also be a whole 6-byte block from data start
+	uint32_t fptr = 100 + 6 * 37;
+	rd = ReadTuner::sector_aligned_read(fptr, 9216, 100, 6);
+	CHECK((fptr + rd) % 512 == 0);
+	CHECK((fptr + rd - 100) % 6 == 0);
+	CHECK(rd > 9216 - 1536);
+	CHECK(ReadTuner::sector_aligned_read(fptr + rd, 9216, 100, 6) == 9216);
+
+	// No aligned end possible (odd data start, 24-bit stereo): read as asked
+	CHECK(ReadTuner::sector_aligned_read(101, 3072, 101, 6) == 3072);
+}
+
+TEST_CASE("A reverse read is shortened to start on a sector and a sample block") {
+	// 16-bit stereo, data starting at 44, reading back from an unaligned end
+	uint32_t end = 44 + 40000;
+	uint32_t rd = ReadTuner::reverse_aligned_read(end, 9216, 44, 4);
+	CHECK((end - rd) % 512 == 0);
+	CHECK((end - rd - 44) % 4 == 0);
+	CHECK(rd > 9216 - 512);
+
+	// Then reads of granule multiples stay whole
+	CHECK(ReadTuner::reverse_aligned_read(end - rd, 9216, 44, 4) == 9216);
+
+	// 24-bit stereo
+	end = 100 + 6 * 5000;
+	rd = ReadTuner::reverse_aligned_read(end, 9216, 100, 6);
+	CHECK((end - rd) % 512 == 0);
+	CHECK((end - rd - 100) % 6 == 0);
+	CHECK(ReadTuner::reverse_aligned_read(end - rd, 9216, 100, 6) == 9216);
+
+	CHECK(ReadTuner::reverse_aligned_read(101 + 6000, 3072, 101, 6) == 3072);
+}
@@ -88,3 +88,30 @@ TEST_CASE("calc_stop_cuenum") {
 		CHECK(calc_stop_point(0.51, rs, &s, start_pos, start_cue, sr) == expected);
 	}
 }
+
+TEST_CASE("A prefetch is kept while the start position only moves by ADC noise") {
+	using namespace SamplerKit;
+	Sample s;
+	s.inst_start = 0;
+	s.inst_end = 10'000'000; // about 52s of 16-bit stereo
+	s.blockAlign = 4;
+	s.num_cues = 0;
+
+	// One ADC LSB of the Start knob moves the start position by inst_size / 4096
+	const float start = 0.5f;
+	const uint32_t startpos = calc_start_point(start, &s, -1, false);
+	const uint32_t low = calc_prefetch_start(startpos);
+	CHECK(low == startpos - PREFETCH_MARGIN);
+	CHECK(low % s.blockAlign == 0);
+
+	for (int lsb = -1; lsb <= 1; lsb++)
+		CHECK(prefetch_covers(low, calc_start_point(start + lsb / 4096.f, &s, -1, false)));
+
+	// Moving the knob further restarts it
+	CHECK_FALSE(prefetch_covers(low, calc_start_point(start + 3 / 4096.f, &s, -1, false)));
+	CHECK_FALSE(prefetch_covers(low, calc_start_point(start - 3 / 4096.f, &s, -1, false)));
+
+	// Near the start of the sample the prefetch starts at 0
+	CHECK(calc_prefetch_start(100) == 0);
+	CHECK(prefetch_covers(0, 100));
+}
@@ -0,0 +1,95 @@
+#include "doctest.h"
+//
+#include "host_memory.hh"
+#include "spsc_ring.hh"
+#include <vector>
+
+using namespace SamplerKit;
+
+namespace
+{
+constexpr uint32_t RingSize = 0x100;
+}
+
+TEST_CASE("SpscRing fill level is exact when empty and full") {
+	HostMemory mem{RingSize};
+	REQUIRE(mem.base);
+	SpscRing ring;
+	ring.init(mem.addr(), RingSize);
+
+	CHECK(ring.available() == 0);
+	CHECK(ring.space() == RingSize);
+
+	std::vector<uint8_t> block(RingSize);
+	for (uint32_t i = 0; i < block.size(); i++)
+		block[i] = (uint8_t)i;
+
+	// Full: the positions are equal modulo the size, but the counts are not
+	CHECK(ring.push(block.data(), RingSize));
+	CHECK(ring.available() == RingSize);
+	CHECK(ring.space() == 0);
+	CHECK_FALSE(ring.push(block.data(), 1));
+	CHECK(ring.available() == RingSize);
+
+	std::vector<int16_t> out(RingSize / 2);
+	CHECK(ring.memory_read16(out.data(), out.size()) == 0);
+	CHECK(ring.available() == 0);
+	CHECK(out[1] == (int16_t)0x0302);
+}
+
+TEST_CASE("SpscRing push is rejected whole when it does not fit") {
+	HostMemory mem{RingSize};
+	REQUIRE(mem.base);
+	SpscRing ring;
+	ring.init(mem.addr(), RingSize);
+
+	std::vector<uint8_t> block(0x60, 0xAA);
+	CHECK(ring.push(block.data(), block.size()));
+	CHECK(ring.push(block.data(), block.size()));
+	CHECK_FALSE(ring.push(block.data(), block.size()));
+	CHECK(ring.available() == 0xC0);
+}
+
+TEST_CASE("SpscRing data survives wrapping, and reads past the end are zero-filled") {
+	HostMemory mem{RingSize};
+	REQUIRE(mem.base);
+	SpscRing ring;
+	ring.init(mem.addr(), RingSize);
+
+	// 24-bit frames of 6 bytes, so pushes and reads straddle the end of memory at different offsets
+	uint8_t next_in = 0;
+	uint8_t next_out = 0;
+	for (uint32_t round = 0; round < 100; round++) {
+		uint8_t block[6 * 7];
+		for (auto &b : block)
+			b = next_in++;
+		REQUIRE(ring.push(block, sizeof block));
+
+		uint8_t out[3 * 14];
+		CHECK(ring.memory_read24(out, 14) == 0);
+		for (auto b : out)
+			CHECK(b == next_out++);
+	}
+	CHECK(ring.available() == 0);
+
+	uint8_t block[9];
+	for (auto &b : block)
+		b = next_in++;
+	REQUIRE(ring.push(block, sizeof block));
+
+	uint8_t out24[12];
+	CHECK(ring.memory_read24(out24, 4) == 1);
+	for (uint32_t i = 0; i < 9; i++)
+		CHECK(out24[i] == next_out++);
+	for (uint32_t i = 9; i < 12; i++)
+		CHECK(out24[i] == 0);
+
+	int16_t s = 0x1234;
+	REQUIRE(ring.push(&s, 2));
+	int16_t out16[4] = {1, 1, 1, 1};
+	CHECK(ring.memory_read16(out16, 4) == 3);
+	CHECK(out16[0] == 0x1234);
+	CHECK(out16[1] == 0);
+	CHECK(out16[3] == 0);
+	CHECK(ring.available() == 0);
+}
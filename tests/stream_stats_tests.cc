@@ -0,0 +1,53 @@
+#include "doctest.h"
+//
+#include "stream_stats.hh"
+
+using namespace SamplerKit;
+
+TEST_CASE("StreamStats histograms the fill level, and keeps the lowest while playing") {
+	StreamStats st;
+	constexpr uint32_t Size = 0x10000;
+
+	st.record_fill(0, Size, false); // empty while prebuffering: not a minimum
+	st.record_fill(Size / 2, Size, true);
+	st.record_fill(Size / 16 - 1, Size, true);
+	st.record_fill(Size, Size, true);
+	st.record_fill(Size * 2, Size, true); // overrun
+
+	CHECK(st.min_fill == Size / 16 - 1);
+	CHECK(st.fill_histogram[0] == 2);
+	CHECK(st.fill_histogram[8] == 1);
+	CHECK(st.fill_histogram[15] == 2);
+
+	st.underruns++;
+	st.overruns++;
+	st.bytes_streamed = 1234;
+
+	st.reset();
+	CHECK(st.min_fill == UINT32_MAX);
+	CHECK(st.fill_histogram[0] == 0);
+	CHECK(st.underruns == 0);
+	CHECK(st.overruns == 0);
+	CHECK(st.bytes_streamed == 0);
+}
+
+TEST_CASE("StreamStats adds up the time spent prebuffering") {
+	StreamStats st;
+	st.record_prebuffering(100, false);
+	st.record_prebuffering(110, true);
+	st.record_prebuffering(111, true);
+	st.record_prebuffering(150, false);
+	CHECK(st.prebuffer_ms == 40);
+
+	st.record_prebuffering(200, true);
+	st.record_prebuffering(205, false);
+	st.record_prebuffering(300, false);
+	CHECK(st.prebuffer_ms == 45);
+
+	// A reset while prebuffering counts from the next service
+	st.record_prebuffering(400, true);
+	st.reset();
+	st.record_prebuffering(410, true);
+	st.record_prebuffering(420, false);
+	CHECK(st.prebuffer_ms == 10);
+}
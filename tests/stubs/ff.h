@@ -42,8 +42,9 @@ inline FRESULT f_close(FIL *fp) {
 	return fclose(fp);
 }
 
+// Like FatFs, *br is the number of bytes read, so a read that runs into the end of the file is short, not 0
 inline FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br) {
-	*br = fread(buff, btr, 1, fp);
+	*br = fread(buff, 1, btr, fp);
 	return FR_OK;
 }
 
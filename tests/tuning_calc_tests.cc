@@ -0,0 +1,23 @@
+#include "doctest.h"
+
+#include "lut/pitch_pot_lut.h"
+#include "lut/voltoct.h"
+#include "tuning_calcs.hh"
+
+using namespace SamplerKit;
+
+TEST_CASE("Pitch pot in the center detent, with no CV, is unity pitch") {
+	const uint32_t no_cv = TuningCalcs::apply_tracking_compensation(2048, 1.02f);
+	CHECK(no_cv == 2048);
+
+	for (uint32_t potval : {1920u, 2048u, 2175u}) {
+		CAPTURE(potval);
+		CHECK(TuningCalcs::is_unity_pitch(pitch_pot_lut[potval] * voltoct[no_cv]));
+		CHECK(TuningCalcs::is_unity_pitch(pitch_pot_lut[potval] * TuningCalcs::quantized_semitone_voct(no_cv)));
+	}
+
+	// Just out of the detent, or one step of CV, is transposed
+	CHECK_FALSE(TuningCalcs::is_unity_pitch(pitch_pot_lut[1919] * voltoct[no_cv]));
+	CHECK_FALSE(TuningCalcs::is_unity_pitch(pitch_pot_lut[2176] * voltoct[no_cv]));
+	CHECK_FALSE(TuningCalcs::is_unity_pitch(pitch_pot_lut[2048] * voltoct[2047]));
+}